@@ -13,6 +13,8 @@
 #include <chrono>
 #include <vector>
 
+#include "misc/AllocationCounter.h"
+
 using namespace Eigen;
 
 using namespace adekf;
@@ -136,6 +138,8 @@ void testHanddataset(bool withPrecision, unsigned repetitions) {
 
     ADEKF ekf(SO3d(trackerDataVector[0].rot), Matrix3d::Identity());
 
+    ADEKF<SO3d, float> ekfMixed(SO3d(trackerDataVector[0].rot), Matrix3d::Identity());
+
     ukfom::ukf<MTK::SO3<double>> ukf(MTK::SO3<double>(trackerDataVector[0].rot), Matrix3d::Identity());
 
 
@@ -179,6 +183,27 @@ void testHanddataset(bool withPrecision, unsigned repetitions) {
     mseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count();
     std::cout << "ekf: " << mseconds << " ms" << std::endl;
 
+    epoch = std::chrono::high_resolution_clock::now();
+    for (unsigned j = 0; j < (withPrecision ? 1 : repetitions); j++) {
+        unsigned trackerIdx = 0;
+        for (const IMUData& data : imuDataVector) {
+            TrackerData tData = trackerDataVector[trackerIdx];
+
+            ekfMixed.predict([](auto state, auto u){state = state + (0.01 * u);}, Matrix3d::Identity(), data.gyro);
+
+            if (tData.timestamp <= data.timestamp) {
+                ekfMixed.update([](auto state){return state;}, Matrix3d::Identity() * 0.1, SO3d(tData.rot));
+
+                if (trackerIdx + 1 < trackerDataVector.size())
+                    trackerIdx++;
+            }
+        }
+    }
+    now = std::chrono::high_resolution_clock::now();
+    mseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count();
+    std::cout << "ekfMixed: " << mseconds << " ms, angle to ekf: " << (ekfMixed.mu - ekf.mu).norm()
+              << " rad, max sigma difference: " << (ekfMixed.sigma - ekf.sigma).cwiseAbs().maxCoeff() << std::endl;
+
     epoch = std::chrono::high_resolution_clock::now();
     for (unsigned j = 0; j < (withPrecision ? 1 : repetitions); j++) {
         unsigned trackerIdx = 0;
@@ -483,41 +508,113 @@ void testSLAM(bool enableLandmarks, bool log) {
     auto mseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count();
     std::cout << "ekf with jacobians: " << mseconds << " ms" << std::endl;
 
-    std::fill(seen_landmark,seen_landmark+MaxLandmarks,false);
+    //The differentiation variants of the ADEKF
+    enum class Differentiation { Dense, Sparse, Chunked, Colored, Batch, Active };
+    //Runs the ADEKF on the dataset and reports the runtime and the number of heap allocations
+    auto runADEKF = [&](ADEKF<State<double>> &filter, const std::string &name, bool logPos,
+                        Differentiation mode = Differentiation::Dense) {
+        //The sparsity pattern of a model can only be cached if it does not depend on the controls
+        auto predict = [&](auto dynamicModel, const Cov &Q, const auto &u, bool constantPattern) {
+            switch (mode) {
+                case Differentiation::Dense:
+                case Differentiation::Batch: filter.predict(dynamicModel, Q, u); break;
+                case Differentiation::Sparse: filter.predictSparse(dynamicModel, Q, u); break;
+                case Differentiation::Chunked: filter.predictChunked(dynamicModel, Q, u); break;
+                case Differentiation::Colored:
+                    if (constantPattern)
+                        filter.predictColored(dynamicModel, Q, u);
+                    else
+                        filter.predictSparse(dynamicModel, Q, u);
+                    break;
+                case Differentiation::Active: filter.predictActive(dynamicModel, Q, u); break;
+            }
+        };
+        //The landmark observations of a step for the batch update
+        std::vector<std::tuple<decltype(measLand), Matrix2d, Vector2d, unsigned>> observations;
+        //The active subspace of a landmark measurement
+        std::vector<Index> landmarkSubspace;
+        auto update = [&](auto measurementModel, const Matrix2d &R, const Vector2d &z, unsigned idx) {
+            switch (mode) {
+                case Differentiation::Dense: filter.update(measurementModel, R, z, idx); break;
+                case Differentiation::Sparse: filter.updateSparse(measurementModel, R, z, idx); break;
+                case Differentiation::Chunked: filter.updateChunked(measurementModel, R, z, idx); break;
+                case Differentiation::Colored: filter.update(measurementModel, R, z, idx); break;
+                //Collected and applied at the end of the step
+                case Differentiation::Batch: observations.emplace_back(measurementModel, R, z, idx); break;
+                //A landmark measurement only depends on the pose and the landmark
+                case Differentiation::Active:
+                    landmarkSubspace.assign({0, 1, 2, Index(idx), Index(idx) + 1});
+                    filter.updateActive(landmarkSubspace, measurementModel, R, z, idx);
+                    break;
+            }
+        };
+        std::fill(seen_landmark, seen_landmark + MaxLandmarks, false);
 
-    epoch = std::chrono::high_resolution_clock::now();
+        auto start = std::chrono::high_resolution_clock::now();
+        std::size_t allocationsBefore = allocationCounter;
 
+        for (unsigned i = 0; i < MaxSteps; i++) {
+            const Step &s = steps[i];
 
-    for(unsigned i = 0; i < MaxSteps; i++) {
-        const Step& s = steps[i];
+            //std::cout << i+1 << "/" << MaxSteps << std::endl;
 
-        //std::cout << i+1 << "/" << MaxSteps << std::endl;
-
-        Cov cov = Cov::Zero(StateSize, StateSize);
-        cov.topLeftCorner<3,3>() = s.cov;
-        ekf.predict(stepDyn, cov, s);
-        ekf.mu(2) = fmod(ekf.mu(2), M_PI * 2);
-        if(ekf.mu(2) < double(0))
-            ekf.mu(2) += M_PI * 2;
+            Cov cov = Cov::Zero(StateSize, StateSize);
+            cov.topLeftCorner<3, 3>() = s.cov;
+            predict(stepDyn, cov, s, true);
+            filter.mu(2) = fmod(filter.mu(2), M_PI * 2);
+            if (filter.mu(2) < double(0))
+                filter.mu(2) += M_PI * 2;
 
-        for(const Meas& m : s.landmarks) {
-            unsigned idx = 3 + (2 * (m.id - 1));
-            if(seen_landmark[m.id - 1]) {
-                ekf.update(measLand,m.cov,m.pos,idx);
-            } else {
-                ekf.mu.segment<2>(idx) = m.pos;
-                ekf.sigma.block<2,2>(idx, idx) = m.cov;
-                ekf.predict(initLand,cov,idx);
-                seen_landmark[m.id - 1] = true;
+            for (const Meas &m : s.landmarks) {
+                unsigned idx = 3 + (2 * (m.id - 1));
+                if (seen_landmark[m.id - 1]) {
+                    update(measLand, m.cov, m.pos, idx);
+                } else {
+                    filter.mu.segment<2>(idx) = m.pos;
+                    filter.sigma.block<2, 2>(idx, idx) = m.cov;
+                    predict(initLand, cov, idx, false);
+                    seen_landmark[m.id - 1] = true;
+                }
+            }
+            if (!observations.empty()) {
+                filter.updateBatch(observations);
+                observations.clear();
             }
+            if (logPos)
+                slam_adekf_pos << filter.mu[0] << ";" << filter.mu[1] << ";" << filter.mu[2] << std::endl;
         }
-        if(log)
-            slam_adekf_pos << ekf.mu[0] << ";" << ekf.mu[1] << ";" << ekf.mu[2] << std::endl;
-    }
 
-    now = std::chrono::high_resolution_clock::now();
-    mseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - epoch).count();
-    std::cout << "ekf: " << mseconds << " ms" << std::endl;
+        auto end = std::chrono::high_resolution_clock::now();
+        std::cout << name << ": " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms, "
+                  << allocationCounter - allocationsBefore << " allocations" << std::endl;
+    };
+
+    //The same filter without the Jet arena, every derivative vector is allocated on the heap
+    ADEKF ekfHeap(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    ekfHeap.jetArena.setEnabled(false);
+    runADEKF(ekfHeap, "ekf without jet arena", false);
+
+    //The same filter with sparse Jets, each model evaluation only touches the used landmarks
+    ADEKF ekfSparse(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    runADEKF(ekfSparse, "ekf with sparse jets", false, Differentiation::Sparse);
+
+    //The same filter with chunks of fixed size Jets
+    ADEKF ekfChunked(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    runADEKF(ekfChunked, "ekf with chunked jets", false, Differentiation::Chunked);
+
+    //The same filter with colored Jacobian columns
+    ADEKF ekfColored(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    runADEKF(ekfColored, "ekf with colored jets", false, Differentiation::Colored);
+
+    //The same filter with one stacked update of all landmarks per step
+    ADEKF ekfBatch(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    runADEKF(ekfBatch, "ekf with batch updates", false, Differentiation::Batch);
+
+    //The same filter which only transforms the rows and columns of the covariance touched by a model
+    ADEKF ekfActive(State<double>::Zero(), Cov::Zero(StateSize, StateSize));
+    runADEKF(ekfActive, "ekf with active subspaces", false, Differentiation::Active);
+
+    runADEKF(ekf, "ekf", log);
 
     std::fill(seen_landmark,seen_landmark+MaxLandmarks,false);
 
@@ -553,6 +650,11 @@ void testSLAM(bool enableLandmarks, bool log) {
     std::cout.precision(17);
     std::cout << ekfwj.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
     std::cout << ekf.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
+    std::cout << ekfSparse.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
+    std::cout << ekfChunked.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
+    std::cout << ekfColored.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
+    std::cout << ekfBatch.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
+    std::cout << ekfActive.mu.head<3>().format(IOFormat(FullPrecision)) << std::endl << std::endl;
     std::cout << ukf.mu_.head<3>().format(IOFormat(FullPrecision)) << std::endl;
     std::cout << "----------END TEST SLAM----------" << std::endl;
 
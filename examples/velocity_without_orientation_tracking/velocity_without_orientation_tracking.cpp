@@ -22,11 +22,11 @@ int main(){
     // Initialise noise
     Eigen::Matrix3d __IN_processNoise=__IN_processNoise.Identity();
     Eigen::Matrix3d __IN_measurement_noise=__IN_measurement_noise.Identity();
-    //Call predict to apply acceleration on velocity
-    ekf.predict(dynamic_model,__IN_processNoise,__IN_acceleration,__IN_time_diff);
+    //Call predict to apply acceleration on velocity, the model is linear so its Jacobian is only computed once
+    ekf.predictLinear(dynamic_model,__IN_processNoise,__IN_acceleration,__IN_time_diff);
 
     //Correct estimation with a measurement update
-    ekf.update(measurement_model,__IN_measurement_noise,__IN_velocity);
+    ekf.updateLinear(measurement_model,__IN_measurement_noise,__IN_velocity);
 
 
     //print out ekf state
@@ -1,11 +1,23 @@
 #pragma once
 
 #include <Eigen/LU>
+#include <Eigen/Cholesky>
 
 #include "ceres/jet.h"
 #include "ADEKFUtils.h"
+#include "SparsityPattern.h"
+#include "FilterWorkspace.h"
+#include "FixedLagSmoother.h"
 
+#include <algorithm>
+#include <any>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
 
 
 namespace adekf {
@@ -14,11 +26,31 @@ namespace adekf {
     using namespace Eigen;
     using namespace std::placeholders;
 
+    /**
+     * The result of a Mahalanobis gate
+     */
+    struct GateResult {
+        /**
+         * Whether the measurement passed the gate and was applied
+         */
+        bool accepted;
+        /**
+         * The normalized innovation squared delta^T*S^-1*delta
+         */
+        double nis;
+    };
+
     /**
      * An EKF Implementation for automatic differentiation of Jacobian Matrices
+     *
+     * The precision of the differentiation is a policy of the filter. With float Jets and a double State, predict and
+     * forward mode update evaluate the models once with float Jets, which take half the memory and fill twice as many
+     * SIMD lanes. The new estimate and the predicted measurement are read from the real parts of the Jets and converted
+     * back, the covariance and the Kalman gain are calculated with the scalar type of the State.
      * @tparam State The State to be used for estimation
+     * @tparam JetScalarType The scalar type of the Jets of predict and update, the scalar type of the State by default
      */
-    template<typename State>
+    template<typename State, typename JetScalarType = typename StateInfo<State>::ScalarType>
     class ADEKF {
         /**
          * The DOF of the State
@@ -30,6 +62,23 @@ namespace adekf {
          */
         using ScalarType = typename StateInfo<State>::ScalarType;
 
+        /**
+         * Whether predict and update differentiate with Jets of another scalar type than the State
+         */
+        static constexpr bool mixedPrecision = !std::is_same<JetScalarType, ScalarType>::value;
+
+        /**
+         * The DOF rounded up to whole 16 byte SIMD registers of the precision policy
+         */
+        static constexpr int paddedDOF = (DOF * int(sizeof(JetScalarType)) + 15) / 16 * 16 / int(sizeof(JetScalarType));
+
+        /**
+         * The number of dual components of the Jets of the precision policy. Eigen only vectorizes fixed size vectors
+         * which fill whole registers, so small states are padded as long as the Jets stay fixed size, e.g. to 4 float
+         * components for a 3 DOF state.
+         */
+        static constexpr int mixedJetSize = ceres::Jet<JetScalarType, paddedDOF>::dynamic ? DOF : paddedDOF;
+
         /**
          * A Matrix with the Scalar Type of the State
          * @tparam N Number of Rows
@@ -62,6 +111,19 @@ namespace adekf {
         template<int N>
         using Derivator = Matrix<ceres::Jet<ScalarType, N>, N, 1>;
 
+        /**
+         * A Matrix type which is dynamic sized if one of its dimensions is dynamic or if it is too large for the stack
+         * @tparam N Number of Rows
+         * @tparam M Number of Columns
+         */
+        template<int N, int M>
+        using AutoMatrix = typename std::conditional<N == Dynamic || M == Dynamic || dynamicMatrix<N, M>, MatrixType<-1, -1>, MatrixType<N, M>>::type;
+
+        /**
+         * The storage type of the dynamic sized temporaries
+         */
+        using Workspace = FilterWorkspace<ScalarType>;
+
         static_assert(DOF > 0, "Only Fixed Size States and Manifolds are supported");
 
     public:
@@ -80,6 +142,24 @@ namespace adekf {
          */
         Covariance sigma;
 
+        /**
+         * Storage for the derivative parts of dynamic sized Jets during a single predict or update.
+         * Reset after each step. Disable it with jetArena.setEnabled(false) to use the heap instead.
+         */
+        ceres::JetArena jetArena;
+
+        /**
+         * Storage for the dynamic sized matrices of predict and update, e.g. Jacobians and the Kalman Gain.
+         * Freed after each step unless enabled with workspace.setEnabled(true) or the constructor.
+         */
+        Workspace workspace;
+
+        /**
+         * A fixed lag smoother which records the predictions of the filter, e.g. ekf.smoother.emplace(10).
+         * The predictions of the SqrtADEKF and the UDADEKF are not recorded.
+         */
+        std::optional<FixedLagSmoother<State>> smoother;
+
         /**
          * Constructor of the ADEKF
          * @param _mu Initial Expected Value of the State
@@ -87,6 +167,21 @@ namespace adekf {
          */
         ADEKF(const State &_mu, const Covariance &_sigma) : mu(_mu), sigma(_sigma) {}
 
+        /**
+         * Constructor of the ADEKF which optionally keeps its temporaries between steps
+         *
+         * With a kept workspace, predict and update do not allocate any heap memory once each measurement size was
+         * used once. Use workspace.reserve(DOF, measurementDOF) to allocate the measurement temporaries in advance.
+         * @param _mu Initial Expected Value of the State
+         * @param _sigma Initial Covariance of the State
+         * @param keepWorkspace Whether the temporaries are allocated here and kept between steps
+         */
+        ADEKF(const State &_mu, const Covariance &_sigma, bool keepWorkspace) : mu(_mu), sigma(_sigma) {
+            workspace.setEnabled(keepWorkspace);
+            if (keepWorkspace && dynamicMatrix<DOF, DOF>)
+                workspace.reserve(DOF);
+        }
+
 
         /**
          * Predict the State Estimate with automatically differentiated Jacobian Matrices
@@ -98,22 +193,27 @@ namespace adekf {
          */
         template<typename DynamicModel, typename... Controls>
         void predict(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
-            //The Jacobian to be calculated from the dynamic Model
-            JacobianOf<State> F(DOF, DOF);
-            //Bind the control vectors to the dynamic Model
-            auto f = std::bind(dynamicModel, _1, u...);
-            //Add a dual component vector to the state
-            auto input = eval(mu + getDerivator<DOF>());
-            //Evaluate the dynamic model
-            f(input);
-            //Calculate the Jacobian Matrix and set the new State Estimate
-            predict_impl(input, f, input, F);
-            //The dynamic model has to be differentiable
-            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
-            //Calculate the new Covariance
-            sigma = F * sigma * F.transpose() + Q;
+            if constexpr (mixedPrecision)
+                predictMixed(dynamicModel, Q, u...);
+            else
+                predictWithDerivator(getDerivator<DOF, ScalarType>(), dynamicModel, Q, u...);
         }
 
+        /**
+         * Predict the State Estimate with Jacobian Matrices differentiated by sparse dual numbers
+         *
+         * Each dual number only stores the derivatives which are non zero. This is faster than predict if the dynamic
+         * model only changes a few entries of a large state, e.g. adding a landmark in SLAM.
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predictSparse(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            predictWithDerivator(getSparseDerivator<DOF>(), dynamicModel, Q, u...);
+        }
 
         
         /**
@@ -128,12 +228,15 @@ namespace adekf {
         template<int NoiseDim, typename DynamicModel, typename... Controls>
         void predictWithNonAdditiveNoise(DynamicModel dynamicModel, const SquareMatrixType<NoiseDim> &Q,
                                          const Controls &...u) {
+            beginPrediction();
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
             //The Jacobian to be calculated from the dynamic Model
             MatrixType<DOF, DOF + NoiseDim> F(DOF, DOF + NoiseDim);
             //Bind the control vectors to the dynamic Model
             auto f = std::bind(dynamicModel, _1, _2, u...);
             //Generate a Vector of dual components for the state and noise vector
-            auto derivator = getDerivator<DOF + NoiseDim>();
+            auto derivator = getDerivator<DOF + NoiseDim, ScalarType>();
             //Add the first DOF cells of the dual component vector to the State
             auto input = eval(mu + derivator.template head<DOF>());
             //Evaluate the dynamic model with the NoiseDim last cells of the dual component vector
@@ -144,8 +247,12 @@ namespace adekf {
             //The dynamic model has to be differentiable
             assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
             //Calculate the new Covariance
-            sigma = F.template leftCols<DOF>() * sigma * F.template leftCols<DOF>().transpose() +
-                    F.template rightCols<NoiseDim>() * Q * F.template rightCols<NoiseDim>().transpose();
+            transformCovariance(F.template leftCols<DOF>(), sigma);
+            //The noise is only added to the lower triangle
+            MatrixType<DOF, NoiseDim> FQ = F.template rightCols<NoiseDim>() * Q;
+            sigma.template triangularView<Lower>() += FQ * F.template rightCols<NoiseDim>().transpose();
+            symmetrizeFromLower(sigma);
+            endPrediction(F.template leftCols<DOF>());
          }
 
 
@@ -162,12 +269,15 @@ namespace adekf {
          */
         template<typename DynamicModel, typename JacobianFunc, typename... Controls>
         void predictWithJacobian(DynamicModel f, JacobianFunc jacobianFunc, const Covariance &Q, const Controls &...u) {
+            beginPrediction();
             //The Jacobian, calculated from the given function
             auto F = jacobianFunc(mu, u...);
             //Evaluate the dynamic model and set the new state estimate
             f(mu, u...);
             //Calculate the new covariance
-            sigma = F * sigma * F.transpose() + Q;
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
         }
 
         /**
@@ -176,205 +286,1830 @@ namespace adekf {
          * @tparam MeasurementModel Type of the Measurement Model Functor
          * @tparam Variables Types of Auxiliary Variables for the Measurement Model
          * @param measurementModel The Measurement Model h(x,variables)
-         * @param R Additive Measurement Noise Covariance
+         * @param R Additive Measurement Noise Covariance. Diagonal noise (e.g. r.asDiagonal()) is processed component wise
          * @param z Measurement
          * @param variables Auxiliary Variables for the Measurement Model
          */
         template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
-        void update(MeasurementModel measurementModel, const MatrixBase<Derived> &R, const Measurement &z,
+        void update(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
                     const Variables &...variables) {
+            //Reverse mode needs one sweep per measurement DOF instead of Jets with DOF dual components
+            if constexpr (ADEKF_REVERSE_MODE_RATIO > 0 && DOFOf<Measurement> * ADEKF_REVERSE_MODE_RATIO <= DOF)
+                updateReverse(measurementModel, R, z, variables...);
+            //The precision policy only applies to forward mode
+            else if constexpr (mixedPrecision)
+                updateMixed(measurementModel, R, z, variables...);
+            else
+                updateWithDerivator(getDerivator<DOF, ScalarType>(), measurementModel, R, z, variables...);
+        }
+
+        /**
+         * Update the State Estimate with Jacobian Matrices differentiated in reverse mode
+         *
+         * The measurement model is evaluated once while all operations are recorded on a tape. Each row of the
+         * Jacobian is then calculated by a reverse sweep over the tape. This is faster than update with forward mode
+         * if the measurement has much less DOF than the state. update() chooses this automatically,
+         * see ADEKF_REVERSE_MODE_RATIO.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateReverse(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                           const Variables &...variables) {
             //Bind the auxiliary variables to the measurement model
             auto h = [&measurementModel, &variables...](const auto &state) {
                 return eval(measurementModel(state, variables ...));
             };
+            typename Workspace::Scope workspaceScope(workspace);
             //The jacobian matrix to be calculated from the measurement model
-            JacobianOf<Measurement> H(DOFOf<Measurement>, DOF);
-            //The result of the measurement model
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model, which is also the reference of the Jacobian
             typename StateInfo<Measurement>::type hx;
-            //The result of the measurement model with a dual component vector added to the state
-            auto input = h(eval(mu + getDerivator<DOF>()));
             //Calculate the Jacobian and the result of the measurement model
-            update_impl(hx, input, h, H);
+            differentiateReverse(h, hx, H);
             //The measurement model has to be differentiable
             assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
-            //Calculate the Innovation covariance
-            auto S = H * sigma * H.transpose() + R;
-            //Calcualte the Kalman Gain
-            auto K = (sigma * H.transpose() * S.inverse()).eval();
-            //Calculate the updated state estimate
-            auto delta=eval(z-hx);
-            //Calcualte the updated covariance estimate
-            add_diff(mu, K * delta, K * H);
-
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - hx));
         }
+
         /**
-         * Transpose overload to handle likelihood of scalar updates
+         * Update the State Estimate with Jacobian Matrices differentiated by sparse dual numbers
+         *
+         * Each dual number only stores the derivatives which are non zero. This is faster than update if the
+         * measurement model only reads a few entries of a large state, e.g. observing a landmark in SLAM.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
          */
-        template<typename Type>
-        auto transpose(const Type & object){
-            return object.transpose();
-        }
-        double transpose(double value){
-            return value;
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateSparse(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                          const Variables &...variables) {
+            updateWithDerivator(getSparseDerivator<DOF>(), measurementModel, R, z, variables...);
         }
 
-        template<typename Derived>
-        double exp(const Eigen::MatrixBase<Derived> & matrix){
-            assert(matrix.rows()==1 && matrix.cols()==1);
-            return std::exp(matrix(0,0));
+        /**
+         * Predict the State Estimate with Jacobian Matrices differentiated in chunks of K columns
+         *
+         * The dynamic model is evaluated DOF/K times with fixed size Jets of K dual components instead of once with
+         * Jets of DOF dual components. The Jets stay on the stack which is more cache friendly for large states.
+         * The dynamic model must not have side effects since it is evaluated several times.
+         * @tparam K The number of Jacobian columns per evaluation
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<int K = ADEKF_JET_CHUNK_SIZE, typename DynamicModel, typename... Controls>
+        void predictChunked(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            beginPrediction();
+            typename Workspace::Scope workspaceScope(workspace);
+            //The Jacobian to be calculated from the dynamic Model
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            //The dynamic model changes its argument, so it is applied on copies of the state
+            auto f = [&dynamicModel, &u...](auto state) {
+                dynamicModel(state, u...);
+                return state;
+            };
+            //The new state estimate, which is also the reference of the Jacobian
+            State newMu = f(mu);
+            //Calculate the Jacobian
+            differentiateChunked<K>(f, newMu, F);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Set the new state estimate
+            mu = newMu;
+            //Calculate the new Covariance
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
         }
 
         /**
-        * Update the State Estimate with automatically differentiated Jacobian Matrices
-        * @tparam Measurement Type of the Measurement
-        * @tparam MeasurementModel Type of the Measurement Model Functor
-        * @tparam Variables Types of Auxiliary Variables for the Measurement Model
-        * @param log_likelihood output: the likelihood of the given measurement
-        * @param measurementModel The Measurement Model h(x,variables)
-        * @param R Additive Measurement Noise Covariance
-        * @param z Measurement
-        * @param variables Auxiliary Variables for the Measurement Model
-        */
-        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
-        void update(double & log_likelihood, MeasurementModel measurementModel, const MatrixBase<Derived> &R, const Measurement &z,
-                    const Variables &...variables) {
-            //Bind the auxiliary variables to the measurement model
-            auto h = [&measurementModel, &variables...](const auto &state) {
-                return eval(measurementModel(state, variables ...));
+         * Predict the State Estimate with Jacobian Matrices differentiated by colored dual components
+         *
+         * On the first call for a dynamic model type, the sparsity pattern of its Jacobian is traced with sparse Jets
+         * and the columns are colored so that columns of one color never have entries in the same row. Afterwards each
+         * prediction needs only one dual component per color instead of one per DOF, e.g. 3 instead of 127 for a SLAM
+         * step which only moves the robot. The model is evaluated in chunks of K colors.
+         *
+         * The pattern is cached per dynamic model type, so it must not depend on the control vectors, the state or the
+         * members of a functor. Function pointers and std::function are rejected at compile time, since different models
+         * of the same signature would share one pattern. Use clearSparsityPatterns() to trace again.
+         * @tparam K The number of colors per evaluation
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<int K = ADEKF_JET_CHUNK_SIZE, typename DynamicModel, typename... Controls>
+        void predictColored(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            beginPrediction();
+            typename Workspace::Scope workspaceScope(workspace);
+            //The Jacobian to be calculated from the dynamic Model
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            //The dynamic model changes its argument, so it is applied on copies of the state
+            auto f = [&dynamicModel, &u...](auto state) {
+                dynamicModel(state, u...);
+                return state;
             };
-            //The jacobian matrix to be calculated from the measurement model
-            JacobianOf<Measurement> H(DOFOf<Measurement>, DOF);
-            //The result of the measurement model
-            typename StateInfo<Measurement>::type hx;
-            //The result of the measurement model with a dual component vector added to the state
-            auto input = h(eval(mu + getDerivator<DOF>()));
-            //Calculate the Jacobian and the result of the measurement model
-            update_impl(hx, input, h, H);
-            //The measurement model has to be differentiable
-            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
-            //Calculate the Innovation covariance
-            auto S = H * sigma * H.transpose() + R;
-            //Calcualte the Kalman Gain
-            auto K = (sigma * H.transpose() * S.inverse()).eval();
-            //Calculate the updated state estimate
-            auto delta=eval(z-hx);
-            //std::cout << delta << std::endl;
-            log_likelihood= -0.5 * (transpose(delta) * S.inverse() * delta)(0)+log(1/sqrt(S.determinant() * pow((2 * M_PI), S.rows())));
-            //Calcualte the updated covariance estimate
-            add_diff(mu, K * delta, K * H);
+            //The new state estimate, which is also the reference of the Jacobian
+            State newMu = f(mu);
+            //Calculate the Jacobian
+            differentiateColored<K>(f, newMu, sparsityOf<DynamicModel>(f, newMu), F);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Set the new state estimate
+            mu = newMu;
+            //Calculate the new Covariance
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
+        }
 
+        /**
+         * Predict the State Estimate in the subspace of the State which the dynamic model reads and writes
+         *
+         * The dynamic model may only change the entries of the active subspace and only depend on them, e.g. the pose
+         * and one landmark in SLAM. Only these entries are seeded with dual components in chunks of K and only the
+         * rows and columns of the Covariance which belong to them are transformed. This costs O(|active|^2*DOF)
+         * instead of O(DOF^3) for F*sigma*F^T.
+         * @tparam K The number of Jacobian columns per evaluation
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param active The sorted indices of the tangent space of the State which the dynamic model reads or writes
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<int K = ADEKF_JET_CHUNK_SIZE, typename DynamicModel, typename... Controls>
+        void predictActive(const std::vector<Index> &active, DynamicModel dynamicModel, const Covariance &Q,
+                           const Controls &...u) {
+            beginPrediction();
+            typename Workspace::Scope workspaceScope(workspace);
+            //The columns of the Jacobian which belong to the active subspace
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            auto FA = F.leftCols(active.size());
+            //The dynamic model changes its argument, so it is applied on copies of the state
+            auto f = [&dynamicModel, &u...](auto state) {
+                dynamicModel(state, u...);
+                return state;
+            };
+            //The new state estimate, which is also the reference of the Jacobian
+            State newMu = f(mu);
+            //Calculate the columns of the Jacobian
+            differentiateActive<K>(f, newMu, active, FA);
+            //The dynamic model has to be differentiable
+            assert(!FA.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Set the new state estimate
+            mu = newMu;
+            //Move the rows of the active subspace to the top, active[i]>=i so no row is overwritten before it is read
+            for (Index i = 0; i < Index(active.size()); ++i)
+                FA.row(i) = FA.row(active[i]);
+            //Calculate the new Covariance
+            transformActiveCovariance(active, FA.topRows(active.size()));
+            sigma += Q;
+            endActivePrediction(active, FA.topRows(active.size()));
         }
 
+        /**
+         * Predict the State Estimate in the subspace of the State which the dynamic model reads and writes
+         *
+         * The active subspace is inferred with sparse dual numbers: it contains the entries whose row of the Jacobian
+         * differs from the identity and the entries these rows depend on. See predictActive(active, ...).
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predictActive(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            beginPrediction();
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
+            //The dynamic model changes its argument, so it is applied on copies of the state
+            auto f = [&dynamicModel, &u...](auto state) {
+                dynamicModel(state, u...);
+                return state;
+            };
+            auto output = f(eval(mu + getSparseDerivator<DOF>()));
+            //The new state estimate, which is also the reference of the Jacobian
+            State newMu = valueOf(output);
+            //The derivatives of all changed entries
+            auto diff = eval(output - newMu);
+            //Entries which keep their row of the identity are passive
+            activeIndices.clear();
+            for (int i = 0; i < DOF; ++i) {
+                int entries = 0;
+                bool identity = true;
+                jetOf(diff, i).v.forEach([&](int column, ScalarType value) {
+                    ++entries;
+                    identity = identity && column == i && value == ScalarType(1);
+                });
+                if (entries != 1 || !identity) {
+                    activeIndices.push_back(i);
+                    jetOf(diff, i).v.forEach([&](int column, ScalarType) { activeIndices.push_back(column); });
+                }
+            }
+            std::sort(activeIndices.begin(), activeIndices.end());
+            activeIndices.erase(std::unique(activeIndices.begin(), activeIndices.end()), activeIndices.end());
+            //The Jacobian in the active subspace
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            auto FAA = F.topLeftCorner(activeIndices.size(), activeIndices.size());
+            FAA.setZero();
+            for (Index i = 0; i < Index(activeIndices.size()); ++i)
+                jetOf(diff, activeIndices[i]).v.forEach([&](int column, ScalarType value) {
+                    FAA(i, activePosition(column)) = value;
+                });
+            //The dynamic model has to be differentiable
+            assert(!FAA.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Set the new state estimate
+            mu = newMu;
+            //Calculate the new Covariance
+            transformActiveCovariance(activeIndices, FAA);
+            sigma += Q;
+            endActivePrediction(activeIndices, FAA);
+        }
 
+        /**
+         * Forgets all sparsity patterns learned by predictColored
+         */
+        void clearSparsityPatterns() {
+            sparsityPatterns.clear();
+        }
 
         /**
-         * Update the State Estimate with automatically differentiated Jacobian Matrices and non-Additive Noise
-         * @tparam NoiseDim The Dimension of the Noise Vector v
+         * Update the State Estimate with Jacobian Matrices differentiated in chunks of K columns
+         *
+         * The measurement model is evaluated DOF/K times with fixed size Jets of K dual components instead of once
+         * with Jets of DOF dual components. The Jets stay on the stack which is more cache friendly for large states.
+         * @tparam K The number of Jacobian columns per evaluation
          * @tparam Measurement Type of the Measurement
          * @tparam MeasurementModel Type of the Measurement Model Functor
          * @tparam Variables Types of Auxiliary Variables for the Measurement Model
-         * @param measurementModel The Measurement Model h(x,v,variables)
-         * @param R non-Additive Measurement Noise Covariance
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
          * @param z Measurement
          * @param variables Auxiliary Variables for the Measurement Model
          */
-        template<int NoiseDim, typename Measurement, typename MeasurementModel, typename... Variables>
-        void updateWithNonAdditiveNoise(MeasurementModel measurementModel, const SquareMatrixType<NoiseDim> &R,
-                                        const Measurement &z, const Variables &...variables) {
-            //The DOF of the Measurement
-            constexpr int MDOF = DOFOf<Measurement>;
+        template<int K = ADEKF_JET_CHUNK_SIZE, typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateChunked(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                           const Variables &...variables) {
             //Bind the auxiliary variables to the measurement model
-            auto h = [&measurementModel, &variables...](const auto &state, const auto &noise) {
-                return eval(measurementModel(state,noise , variables ...));
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
             };
+            typename Workspace::Scope workspaceScope(workspace);
             //The jacobian matrix to be calculated from the measurement model
-            MatrixType<MDOF, DOF + NoiseDim> H(MDOF, DOF);
-            //The result of the measurement model
-            typename StateInfo<Measurement>::type hx;
-            //Generate a Vector of dual components for the state and noise vector
-            auto derivator = getDerivator<DOF + NoiseDim>();
-            //The result of the measurement model with a dual component vector added to the state and the noise
-            auto input = h(eval(mu + derivator.template head<DOF>()), derivator.template tail<NoiseDim>());
-            //Calculate the Jacobian and the result of the measurement model
-            //The noise vector gets set to zero for this
-            update_impl(hx, input, std::bind(h, _1, MatrixType<NoiseDim, 1>::Zero()), H);
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model, which is also the reference of the Jacobian
+            typename StateInfo<Measurement>::type hx = h(mu);
+            //Calculate the Jacobian
+            differentiateChunked<K>(h, hx, H);
             //The measurement model has to be differentiable
             assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
-            //Calculate the Innovation covariance
-            auto S = H.template leftCols<DOF>() * sigma * H.template leftCols<DOF>().transpose() +
-                     H.template rightCols<NoiseDim>() * R * H.template rightCols<NoiseDim>().transpose();
-            //Calcualte the Kalman Gain
-            auto K = (sigma * H.template leftCols<DOF>().transpose() * S.inverse()).eval();
-            //Calculate the updated state estimate
-            //Calcualte the updated covariance estimate
-            add_diff(mu, K * (z - hx), K * H.template leftCols<DOF>());
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - hx));
         }
 
         /**
-         * Update the State Estimate
+         * Update the State Estimate with a measurement model which only depends on a subspace of the State
+         *
+         * Only the entries of the active subspace are seeded with dual components in chunks of K, and P*H^T only
+         * uses the columns of the Covariance which belong to them, e.g. the pose and the observed landmark in SLAM.
+         * @tparam K The number of Jacobian columns per evaluation
          * @tparam Measurement Type of the Measurement
          * @tparam MeasurementModel Type of the Measurement Model Functor
-         * @tparam JacobianFunc Type of the Jacobian of the Measurement Model
          * @tparam Variables Types of Auxiliary Variables for the Measurement Model
-         * @param h The Measurement Model h(x,variables)
-         * @param jacobianFunc The Jacobian of the Measurement Model dh/dx(x,variables)
+         * @param active The sorted indices of the tangent space of the State which the measurement model reads
+         * @param measurementModel The Measurement Model h(x,variables)
          * @param R Additive Measurement Noise Covariance
          * @param z Measurement
          * @param variables Auxiliary Variables for the Measurement Model
          */
-        template<typename Measurement, typename MeasurementModel, typename JacobianFunc, typename Derived, typename... Variables>
-        void updateWithJacobian(MeasurementModel h, JacobianFunc jacobianFunc, const MatrixBase<Derived> &R,
-                                const Measurement &z, const Variables &...variables) {
-            //The jacobian matrix, calculated from the given function
-            auto H = jacobianFunc(mu, variables...);
-            //Calculate the Innovation covariance
-            auto S = H * sigma * H.transpose() + R;
-            //Calcualte the Kalman Gain
-            auto K = (sigma * H.transpose() * S.inverse()).eval();
-            //Calculate the updated state estimate
-            //Calcualte the updated covariance estimate
-            add_diff(mu, K * (z - h(mu, variables...)), K * H);
+        template<int K = ADEKF_JET_CHUNK_SIZE, typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateActive(const std::vector<Index> &active, MeasurementModel measurementModel,
+                          const EigenBase<Derived> &R, const Measurement &z, const Variables &...variables) {
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            //The columns of the Jacobian which belong to the active subspace
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            auto HA = H.leftCols(active.size());
+            //The result of the measurement model, which is also the reference of the Jacobian
+            typename StateInfo<Measurement>::type hx = h(mu);
+            //Calculate the Jacobian
+            differentiateActive<K>(h, hx, active, HA);
+            //The measurement model has to be differentiable
+            assert(!HA.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate and covariance
+            correct(HA, R.derived(), eval(z - hx), nullptr, &active);
         }
 
-
-/**
-         * Update the State Estimate for manifolds and given jacobians
+        /**
+         * Update the State Estimate with a measurement model which only depends on a subspace of the State
+         *
+         * The active subspace is inferred with sparse dual numbers: it contains the entries with non zero columns in
+         * the Jacobian. See updateActive(active, ...).
          * @tparam Measurement Type of the Measurement
          * @tparam MeasurementModel Type of the Measurement Model Functor
-         * @tparam JacobianFunc Type of the Jacobian of the Measurement Model
-         * @tparam JacobianFuncBoxPlus Type of the Jacobian of the boxplus operation
          * @tparam Variables Types of Auxiliary Variables for the Measurement Model
-         * @param h The Measurement Model h(x,variables)
-         * @param jacobianFunc The Jacobian of the Measurement Model dh/dx(x,variables)
-         * @param jacobianFuncBoxPlus The Jacobian of the Boxplus operation ((mu boxplus delta) boxplus diff) boxminus (mu boxplus diff)
+         * @param measurementModel The Measurement Model h(x,variables)
          * @param R Additive Measurement Noise Covariance
          * @param z Measurement
          * @param variables Auxiliary Variables for the Measurement Model
          */
-        template<typename Measurement, typename MeasurementModel, typename JacobianFunc, typename JacobianFuncBoxPlus, typename Derived, typename... Variables>
-        void updateManifoldWithJacobian(MeasurementModel h, JacobianFunc jacobianFunc,
-                                        JacobianFuncBoxPlus jacobianFuncBoxPlus, const MatrixBase<Derived> &R,
-                                        const Measurement &z, const Variables &...variables) {
-            //The jacobian matrix, calculated from the given function
-            auto H = jacobianFunc(mu, variables...);
-            //Calculate the Innovation covariance
-            auto S = H * sigma * H.transpose() + R;
-            //Calcualte the Kalman Gain
-            auto K = (sigma * H.transpose() * S.inverse()).eval();
-            auto y = (K * (z - h(mu, variables...))).eval();
-            //Calculate the updated state estimate
-            State newMu = mu + y;
-            //Definition of the Jacobian of the Boxplus Function
-            JacobianOf<State> D = jacobianFuncBoxPlus(mu, y, variables...);
-            //Set the new Estimated Value
-            mu = newMu;
-            //Calculate the new Covariance Matrix
-            sigma = D * (sigma - (K * H * sigma)) * D.transpose();
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateActive(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                          const Variables &...variables) {
+            static constexpr int MDOF = DOFOf<Measurement>;
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            auto output = h(eval(mu + getSparseDerivator<DOF>()));
+            //The result of the measurement model, which is also the reference of the Jacobian
+            typename StateInfo<Measurement>::type hx = valueOf(output);
+            //The derivatives of the measurement
+            auto diff = eval(output - hx);
+            //The entries the measurement depends on
+            activeIndices.clear();
+            for (int i = 0; i < MDOF; ++i)
+                jetOf(diff, i).v.forEach([&](int column, ScalarType) { activeIndices.push_back(column); });
+            std::sort(activeIndices.begin(), activeIndices.end());
+            activeIndices.erase(std::unique(activeIndices.begin(), activeIndices.end()), activeIndices.end());
+            //The columns of the Jacobian which belong to the active subspace
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(MDOF).H);
+            H.resize(MDOF, DOF);
+            auto HA = H.leftCols(activeIndices.size());
+            HA.setZero();
+            for (int i = 0; i < MDOF; ++i)
+                jetOf(diff, i).v.forEach([&](int column, ScalarType value) {
+                    HA(i, activePosition(column)) = value;
+                });
+            //The measurement model has to be differentiable
+            assert(!HA.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate and covariance
+            correct(HA, R.derived(), eval(z - hx), nullptr, &activeIndices);
+        }
+
+        /**
+         * Update the State Estimate with several Measurements at once
+         *
+         * Each observation is a tuple (measurementModel, R, z, variables...) or a range of such tuples, e.g.
+         * ekf.updateBatch(std::make_tuple(gpsModel, R1, z1), landmarkObservations). All measurement models are
+         * differentiated independently at the current State Estimate. Then a single update with the stacked Jacobian
+         * and the block diagonal noise is applied, so the Covariance is rewritten once instead of once per measurement.
+         * @tparam Observations Types of the observation tuples or ranges of them
+         * @param observations The observations
+         */
+        template<typename... Observations>
+        void updateBatch(const Observations &...observations) {
+            //The total DOF of the measurements, dynamic if it depends on the size of a range
+            static constexpr int MDOF = ((observationDOF<Observations>() == Dynamic) || ...) ? Dynamic
+                                                                                           : (0 + ... + observationDOF<Observations>());
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
+            Index rows = (Index(0) + ... + rowsOf(observations));
+            if (rows == 0)
+                return;
+            auto &buffers = workspace.innovation(rows);
+            //The stacked Jacobian
+            AutoMatrix<MDOF, DOF> localH;
+            auto &H = workspace.select(localH, buffers.H);
+            H.resize(rows, DOF);
+            //The block diagonal Measurement Noise
+            AutoMatrix<MDOF, MDOF> localR;
+            auto &R = workspace.select(localR, buffers.R);
+            R.setZero(rows, rows);
+            //The stacked Innovation
+            MatrixType<MDOF, 1> localDelta;
+            auto &delta = workspace.select(localDelta, buffers.delta);
+            delta.resize(rows);
+            //Differentiate each measurement model into its rows
+            Index row = 0;
+            (linearizeObservations(observations, row, H, R, delta), ...);
+            //Calculate the updated state estimate and covariance
+            correct(H, R, delta);
+        }
+
+        /**
+         * Predict the State Estimate with a cached Jacobian if the dynamic model is linear
+         *
+         * On the first call for a dynamic model type, the Jacobian is differentiated at mu and at a second state. If
+         * both are exactly equal, the model is treated as linear and the Jacobian is cached. Afterwards the dynamic
+         * model is only evaluated with plain scalars. Nonlinear models fall back to predict.
+         *
+         * The Jacobian is cached per dynamic model type together with the control vectors it was probed with. If the
+         * control vectors change, the model is probed again, so use predict for controls which change every step, e.g.
+         * a varying time difference. The Jacobian must not depend on the members of a functor. Function pointers and
+         * std::function are rejected at compile time, since different models of the same signature would share one
+         * Jacobian. Use clearLinearJacobians() to probe again.
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predictLinear(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            //The dynamic model changes its argument, so it is applied on copies of the state
+            auto f = [&dynamicModel, &u...](auto state) {
+                dynamicModel(state, u...);
+                return state;
+            };
+            const auto *cached = linearJacobianOf<DynamicModel>(f, u...);
+            if (!cached) {
+                predict(dynamicModel, Q, u...);
+                return;
+            }
+            beginPrediction();
+            typename Workspace::Scope workspaceScope(workspace);
+            //Copy the Jacobian into its typed storage so fixed size states stay on the stack
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F = *cached;
+            //Set the new state estimate
+            mu = f(mu);
+            //Calculate the new Covariance
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
+        }
+
+        /**
+         * Update the State Estimate with a cached Jacobian if the measurement model is linear
+         *
+         * The measurement model is probed like in predictLinear. Nonlinear models fall back to update.
+         * The Jacobian is cached per measurement model type together with the auxiliary variables, which are compared
+         * like the control vectors in predictLinear. It must not depend on the members of a functor. Function pointers
+         * and std::function are rejected like in predictLinear.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateLinear(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                          const Variables &...variables) {
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            const auto *cached = linearJacobianOf<MeasurementModel>(h, variables...);
+            if (!cached) {
+                update(measurementModel, R, z, variables...);
+                return;
+            }
+            typename Workspace::Scope workspaceScope(workspace);
+            //Copy the Jacobian into its typed storage so fixed size measurements stay on the stack
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H = *cached;
+            typename StateInfo<Measurement>::type hx = h(mu);
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - hx));
+        }
+
+        /**
+         * Forgets all Jacobians cached by predictLinear and updateLinear
+         */
+        void clearLinearJacobians() {
+            linearJacobians.clear();
+        }
+
+        /**
+         * Transpose overload to handle likelihood of scalar updates
+         */
+        template<typename Type>
+        auto transpose(const Type & object){
+            return object.transpose();
+        }
+        double transpose(double value){
+            return value;
+        }
+
+        template<typename Derived>
+        double exp(const Eigen::MatrixBase<Derived> & matrix){
+            assert(matrix.rows()==1 && matrix.cols()==1);
+            return std::exp(matrix(0,0));
+        }
+
+        /**
+        * Update the State Estimate with automatically differentiated Jacobian Matrices
+        * @tparam Measurement Type of the Measurement
+        * @tparam MeasurementModel Type of the Measurement Model Functor
+        * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+        * @param log_likelihood output: the likelihood of the given measurement
+        * @param measurementModel The Measurement Model h(x,variables)
+        * @param R Additive Measurement Noise Covariance
+        * @param z Measurement
+        * @param variables Auxiliary Variables for the Measurement Model
+        */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void update(double & log_likelihood, MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                    const Variables &...variables) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            //The jacobian matrix to be calculated from the measurement model
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //The result of the measurement model with a dual component vector added to the state
+            auto input = h(seededState());
+            //Calculate the Jacobian and the result of the measurement model
+            update_impl(hx, input, h, H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate, covariance and the likelihood of the measurement
+            correct(H, R.derived(), eval(z - hx), &log_likelihood);
+        }
+
+        /**
+         * Update the State Estimate only if the Measurement passes a Mahalanobis gate
+         *
+         * The Innovation delta=z-h(mu) and its covariance S=H*sigma*H^T+R are calculated like in update(). If the
+         * normalized innovation squared delta^T*S^-1*delta exceeds the threshold, the measurement is rejected before the
+         * Kalman Gain is formed and mu and sigma stay untouched. The threshold is a quantile of the chi-square
+         * distribution with the DOF of the measurement, e.g. 7.81 for 95% and 11.34 for 99% of 3 DOF measurements.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param threshold The largest accepted NIS
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         * @return Whether the measurement was applied and its NIS
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        GateResult updateGated(ScalarType threshold, MeasurementModel measurementModel, const EigenBase<Derived> &R,
+                               const Measurement &z, const Variables &...variables) {
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            //The jacobian matrix to be calculated from the measurement model
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            linearize(h, hx, H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Test the NIS and only then calculate the updated state estimate and covariance
+            return correct(H, R.derived(), eval(z - hx), nullptr, nullptr, threshold);
+        }
+
+        /**
+         * Update the State Estimate after a coarse gate without derivatives and the Mahalanobis gate of updateGated
+         *
+         * The measurement model is first evaluated with plain scalars. For every component i of the Innovation,
+         * delta_i^2/S_ii is a lower bound of the NIS, and it remains one if S_ii is replaced by an upper bound. The
+         * measurement is rejected if this bound exceeds the threshold, so gross outliers never pay for the
+         * differentiation. Only the remaining measurements are passed to updateGated.
+         *
+         * coarseS has to bound the diagonal of S=H*sigma*H^T+R from above, e.g. R plus the largest expected
+         * uncertainty of the predicted measurement. A too small bound rejects valid measurements.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param threshold The largest accepted NIS
+         * @param coarseS A matrix whose diagonal bounds the diagonal of the Innovation covariance, e.g. s.asDiagonal()
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         * @return Whether the measurement was applied and its NIS, the lower bound of the NIS if the coarse gate rejected
+         */
+        template<typename Measurement, typename MeasurementModel, typename DerivedS, typename Derived,
+                typename... Variables>
+        GateResult updateTwoPhase(ScalarType threshold, const EigenBase<DerivedS> &coarseS,
+                                  MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                                  const Variables &...variables) {
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            //The Innovation from the measurement model evaluated with plain scalars
+            typename StateInfo<Measurement>::type hx = h(mu);
+            auto innovation = asVector(eval(z - hx));
+            ScalarType bound = (innovation.array().square() / coarseS.derived().diagonal().array()).maxCoeff();
+            if (!(bound <= threshold))
+                return GateResult{false, double(bound)};
+            return updateGated(threshold, measurementModel, R, z, variables...);
+        }
+
+        /**
+         * Update the State Estimate with a Measurement Model which is linearized again at each iterate
+         *
+         * Each iteration differentiates the measurement model at the current iterate x_i and calculates the
+         * Gauss-Newton step e = e0 + K*(z-h(x_i)-H*e0) with the prior offset e0=mu-x_i and the prior covariance moved
+         * to x_i by transformReferenceJacobian. The first iteration equals update(). The iteration stops after
+         * maxIterations or if the norm of the step is below tolerance. Finally the covariance is corrected at the last
+         * iterate and moved along the last step like in update().
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param maxIterations The maximum number of linearizations, at least 1
+         * @param tolerance The iteration has converged if the norm of a step is below this
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         * @return The number of linearizations
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        int iteratedUpdate(int maxIterations, ScalarType tolerance, MeasurementModel measurementModel,
+                           const EigenBase<Derived> &R, const Measurement &z, const Variables &...variables) {
+            assert(maxIterations > 0 && "At least one iteration is required");
+            static constexpr int MDOF = DOFOf<Measurement>;
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            auto &buffers = workspace.innovation(MDOF);
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, buffers.H);
+            H.resize(MDOF, DOF);
+            AutoMatrix<DOF, MDOF> localPHt;
+            auto &PHt = workspace.select(localPHt, buffers.PHt);
+            AutoMatrix<MDOF, MDOF> localS;
+            auto &S = workspace.select(localS, buffers.S);
+            LLT<AutoMatrix<MDOF, MDOF>> localLLT;
+            auto &llt = workspace.select(localLLT, buffers.llt);
+            AutoMatrix<MDOF, DOF> localW;
+            auto &W = workspace.select(localW, buffers.W);
+            MatrixType<MDOF, 1> localWhitened;
+            auto &whitened = workspace.select(localWhitened, buffers.whitened);
+            //The prior, mu holds the current iterate
+            State const prior = mu;
+            Covariance localPrior;
+            auto &priorSigma = workspace.select(localPrior, workspace.prior);
+            priorSigma = sigma;
+            //The step from the current iterate to the next one
+            MatrixType<DOF, 1> step;
+            int iteration = 0;
+            while (true) {
+                ++iteration;
+                //The prior in the tangent space of the current iterate
+                MatrixType<DOF, 1> priorOffset = MatrixType<DOF, 1>::Zero(DOF);
+                if (iteration > 1) {
+                    priorOffset = prior - mu;
+                    sigma = priorSigma;
+                    if constexpr (std::is_base_of_v<Manifold, State>)
+                        transformReferenceCovariance(prior, mu, MatrixType<DOF, 1>(mu - prior), sigma);
+                }
+                {
+                    //Derivative storage of the Jets for this iteration
+                    ceres::JetArena::Scope arenaScope(jetArena);
+                    typename StateInfo<Measurement>::type hx;
+                    auto input = h(seededState());
+                    update_impl(hx, input, h, H);
+                    //The measurement model has to be differentiable
+                    assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+                    whitened = asVector(eval(z - hx)) - H * priorOffset;
+                }
+                //Whitened gain like in correct(): W=L^-1*H*P with S=L*L^T, so K=W^T*L^-1
+                PHt.noalias() = sigma * H.transpose();
+                S = R.derived();
+                S.noalias() += H * PHt;
+                llt.compute(S);
+                assert(llt.info() == Success && "The innovation covariance has to be positive definite");
+                W = PHt.transpose();
+                llt.matrixL().solveInPlace(W);
+                llt.matrixL().solveInPlace(whitened);
+                step = priorOffset;
+                step.noalias() += W.transpose() * whitened;
+                if (iteration == maxIterations || step.norm() < tolerance)
+                    break;
+                mu = mu + step;
+            }
+            //Correct the covariance at the last iterate and move both along the last step
+            add_diff(mu, step, W.transpose());
+            return iteration;
+        }
+
+
+
+        /**
+         * Update the State Estimate with automatically differentiated Jacobian Matrices and non-Additive Noise
+         * @tparam NoiseDim The Dimension of the Noise Vector v
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,v,variables)
+         * @param R non-Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<int NoiseDim, typename Measurement, typename MeasurementModel, typename... Variables>
+        void updateWithNonAdditiveNoise(MeasurementModel measurementModel, const SquareMatrixType<NoiseDim> &R,
+                                        const Measurement &z, const Variables &...variables) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //The DOF of the Measurement
+            constexpr int MDOF = DOFOf<Measurement>;
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state, const auto &noise) {
+                return eval(measurementModel(state,noise , variables ...));
+            };
+            //The jacobian matrix to be calculated from the measurement model
+            MatrixType<MDOF, DOF + NoiseDim> H(MDOF, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //Generate a Vector of dual components for the state and noise vector
+            auto derivator = getDerivator<DOF + NoiseDim, ScalarType>();
+            //The result of the measurement model with a dual component vector added to the state and the noise
+            auto input = h(eval(mu + derivator.template head<DOF>()), derivator.template tail<NoiseDim>());
+            //Calculate the Jacobian and the result of the measurement model
+            //The noise vector gets set to zero for this
+            update_impl(hx, input, std::bind(h, _1, MatrixType<NoiseDim, 1>::Zero()), H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate and covariance with the noise mapped into the measurement space
+            correct(H.template leftCols<DOF>(),
+                    (H.template rightCols<NoiseDim>() * R * H.template rightCols<NoiseDim>().transpose()).eval(),
+                    eval(z - hx));
+        }
+
+        /**
+         * Update the State Estimate
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam JacobianFunc Type of the Jacobian of the Measurement Model
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param h The Measurement Model h(x,variables)
+         * @param jacobianFunc The Jacobian of the Measurement Model dh/dx(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename JacobianFunc, typename Derived, typename... Variables>
+        void updateWithJacobian(MeasurementModel h, JacobianFunc jacobianFunc, const EigenBase<Derived> &R,
+                                const Measurement &z, const Variables &...variables) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //The jacobian matrix, calculated from the given function
+            auto H = jacobianFunc(mu, variables...);
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - h(mu, variables...)));
+        }
+
+
+/**
+         * Update the State Estimate for manifolds and given jacobians
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam JacobianFunc Type of the Jacobian of the Measurement Model
+         * @tparam JacobianFuncBoxPlus Type of the Jacobian of the boxplus operation
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param h The Measurement Model h(x,variables)
+         * @param jacobianFunc The Jacobian of the Measurement Model dh/dx(x,variables)
+         * @param jacobianFuncBoxPlus The Jacobian of the Boxplus operation ((mu boxplus delta) boxplus diff) boxminus (mu boxplus diff)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename JacobianFunc, typename JacobianFuncBoxPlus, typename Derived, typename... Variables>
+        void updateManifoldWithJacobian(MeasurementModel h, JacobianFunc jacobianFunc,
+                                        JacobianFuncBoxPlus jacobianFuncBoxPlus, const MatrixBase<Derived> &R,
+                                        const Measurement &z, const Variables &...variables) {
+            //The jacobian matrix, calculated from the given function
+            auto H = jacobianFunc(mu, variables...);
+            //P*H^T is needed for the Innovation covariance, the Kalman Gain and the Covariance update
+            auto PHt = (sigma * H.transpose()).eval();
+            //Factorize the Innovation covariance S=H*P*H^T+R
+            LLT<InnovationCovarianceOf<decltype(H)>> S(H * PHt + R);
+            assert(S.info() == Success && "The innovation covariance has to be positive definite");
+            //Whiten H*P with the Cholesky factor S=L*L^T: W=L^-1*H*P, so K=W^T*L^-1 and K*H*P=W^T*W
+            auto W = S.matrixL().solve(PHt.transpose()).eval();
+            auto y = (W.transpose() * S.matrixL().solve(z - h(mu, variables...))).eval();
+            //Calculate the updated state estimate
+            State newMu = mu + y;
+            //Definition of the Jacobian of the Boxplus Function
+            JacobianOf<State> D = jacobianFuncBoxPlus(mu, y, variables...);
+            //Set the new Estimated Value
+            mu = newMu;
+            //Calculate the new Covariance Matrix
+            moveCovariance(D, W.transpose());
+
+        }
+
+
+    protected:
+        /**
+         * An empty Covariance for variants which store the Covariance in a factorized form instead of sigma
+         */
+        static Covariance unusedCovariance() {
+            if constexpr (dynamicMatrix<DOF, DOF>)
+                return Covariance();
+            else
+                return Covariance::Zero();
+        }
+
+        /**
+         * Records the measurement model for reverse mode differentiation
+         */
+        ceres::ReverseTape<ScalarType> reverseTape;
+
+        /**
+         * @tparam Model Type of the Model Functor
+         * @return The key of the model type in the caches of the filter
+         */
+        template<typename Model>
+        static std::type_index keyOf() {
+            //Function pointers or std::functions of the same signature would share one entry
+            static_assert(std::is_class_v<Model> && !isStdFunction<Model>,
+                          "Cached models are identified by their type, pass a lambda or functor instead of a function "
+                          "pointer or std::function");
+            return std::type_index(typeid(Model));
+        }
+
+        /**
+         * The sparsity patterns of the dynamic models used with predictColored
+         */
+        std::unordered_map<std::type_index, SparsityPattern> sparsityPatterns;
+
+        /**
+         * The result of probing a model for linearity in predictLinear and updateLinear
+         */
+        struct LinearJacobian {
+            bool linear;
+            MatrixType<Dynamic, Dynamic> jacobian;
+            /**
+             * Copies of the control vectors or auxiliary variables of the probe, a std::tuple of their types
+             */
+            std::any arguments;
+        };
+
+        /**
+         * The probed models, the Jacobian is only stored for linear models
+         */
+        std::unordered_map<std::type_index, LinearJacobian> linearJacobians;
+
+        /**
+         * The type of the State with the dual component vector of getDerivator added
+         */
+        using SeededState = decltype(eval(std::declval<const State &>() + getDerivator<DOF, ScalarType>()));
+
+        /**
+         * mu with the dual component vector added, kept between steps so its derivatives are only set once
+         */
+        std::optional<SeededState> seededMu;
+
+        /**
+         * The active subspace inferred by predictActive and updateActive, kept to reuse its memory
+         */
+        std::vector<Index> activeIndices;
+
+        /**
+         * The rows of the last Jacobian in transformCovariance which are not unit vectors, kept to reuse its memory
+         */
+        std::vector<Index> changedRows;
+
+        /**
+         * A view of state indices, Eigen would copy a std::vector for each indexed view
+         */
+        using IndexView = Map<const Matrix<Index, Dynamic, 1>>;
+
+        static IndexView viewOf(const std::vector<Index> &indices) {
+            return IndexView(indices.data(), indices.size());
+        }
+
+        /**
+         * @param index An index of the inferred active subspace
+         * @return The position of the index in activeIndices
+         */
+        Index activePosition(Index index) const {
+            return std::lower_bound(activeIndices.begin(), activeIndices.end(), index) - activeIndices.begin();
+        }
+
+        /**
+         * Predict the State Estimate with Jacobian Matrices differentiated by the given dual component vector
+         * @tparam DerivatorType Type of the dual component vector (dense or sparse Jets)
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param derivator The dual component vector which is added to the state
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DerivatorType, typename DynamicModel, typename... Controls>
+        void predictWithDerivator(const DerivatorType &derivator, DynamicModel dynamicModel, const Covariance &Q,
+                                  const Controls &...u) {
+            beginPrediction();
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
+            //The Jacobian to be calculated from the dynamic Model
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            //Bind the control vectors to the dynamic Model
+            auto f = std::bind(dynamicModel, _1, u...);
+            //Add a dual component vector to the state
+            auto input = seededState(derivator);
+            //Evaluate the dynamic model
+            f(input);
+            //Calculate the Jacobian Matrix and set the new State Estimate
+            predict_impl(input, f, input, F);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the new Covariance
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
+        }
+
+        /**
+         * Passes the estimate before a prediction to the smoother, if there is one
+         */
+        void beginPrediction() {
+            if (smoother)
+                smoother->recordFiltered(mu, sigma);
+        }
+
+        /**
+         * Passes the Jacobian of a prediction and the predicted estimate to the smoother, if there is one
+         * @param F The Jacobian of the dynamic model
+         */
+        template<typename Derived>
+        void endPrediction(const MatrixBase<Derived> &F) {
+            if (smoother)
+                smoother->recordPredicted(F, mu, sigma);
+        }
+
+        /**
+         * Passes the Jacobian of a prediction in an active subspace to the smoother, if there is one
+         *
+         * The Jacobian is the identity outside of the active subspace.
+         * @param active The sorted indices of the active subspace
+         * @param FAA The Jacobian in the active subspace
+         */
+        template<typename Derived>
+        void endActivePrediction(const std::vector<Index> &active, const MatrixBase<Derived> &FAA) {
+            if (!smoother)
+                return;
+            typename Workspace::Scope workspaceScope(workspace);
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.D);
+            F.setIdentity(DOF, DOF);
+            F(viewOf(active), viewOf(active)) = FAA;
+            endPrediction(F);
+        }
+
+        /**
+         * @tparam Observation The type of an observation tuple (measurementModel, R, z, variables...) or of a range
+         * @return The DOF of the Measurement of the tuple, Dynamic for a range
+         */
+        template<typename Observation>
+        static constexpr int observationDOF() {
+            if constexpr (isRange<Observation>)
+                return Dynamic;
+            else
+                return DOFOf<std::decay_t<std::tuple_element_t<2, Observation>>>;
+        }
+
+        /**
+         * @param observation An observation tuple or a range of them
+         * @return The number of rows of the observation in the stacked Jacobian
+         */
+        template<typename Observation>
+        static Index rowsOf(const Observation &observation) {
+            if constexpr (isRange<Observation>)
+                return std::distance(std::begin(observation), std::end(observation)) *
+                       observationDOF<std::decay_t<decltype(*std::begin(observation))>>();
+            else
+                return observationDOF<Observation>();
+        }
+
+        /**
+         * Differentiates the measurement models of an observation tuple or a range of them into the stacked matrices
+         * @param observation An observation tuple or a range of them
+         * @param row The first row of the observation, advanced behind it
+         * @param H The stacked Jacobian
+         * @param R The block diagonal Measurement Noise
+         * @param delta The stacked Innovation
+         */
+        template<typename Observation, typename DerivedH, typename DerivedR, typename DerivedDelta>
+        void linearizeObservations(const Observation &observation, Index &row, MatrixBase<DerivedH> &H,
+                                   MatrixBase<DerivedR> &R, MatrixBase<DerivedDelta> &delta) {
+            if constexpr (isRange<Observation>) {
+                for (const auto &element : observation)
+                    linearizeObservations(element, row, H, R, delta);
+            } else {
+                std::apply([&](const auto &measurementModel, const auto &Ri, const auto &z, const auto &...variables) {
+                    using Measurement = std::decay_t<decltype(z)>;
+                    static constexpr int MDOF = DOFOf<Measurement>;
+                    //Models are called on a copy as in update()
+                    auto model = measurementModel;
+                    //Bind the auxiliary variables to the measurement model
+                    auto h = [&model, &variables...](const auto &state) {
+                        return eval(model(state, variables ...));
+                    };
+                    //The rows of this measurement in the stacked Jacobian
+                    auto Hi = H.middleRows(row, MDOF);
+                    //The result of the measurement model
+                    typename StateInfo<Measurement>::type hx;
+                    //Same choice of the differentiation mode as update()
+                    if constexpr (ADEKF_REVERSE_MODE_RATIO > 0 && MDOF * ADEKF_REVERSE_MODE_RATIO <= DOF) {
+                        differentiateReverse(h, hx, Hi);
+                    } else {
+                        auto input = h(seededState());
+                        update_impl(hx, input, h, Hi);
+                    }
+                    //The measurement model has to be differentiable
+                    assert(!Hi.hasNaN() && "Differentiation resulted in an indeterminate form");
+                    R.block(row, row, MDOF, MDOF) = Ri;
+                    delta.segment(row, MDOF) = asVector(eval(z - hx));
+                    row += MDOF;
+                }, observation);
+            }
+        }
+
+        /**
+         * Update the State Estimate with Jacobian Matrices differentiated by the given dual component vector
+         * @tparam DerivatorType Type of the dual component vector (dense or sparse Jets)
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param derivator The dual component vector which is added to the state
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename DerivatorType, typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateWithDerivator(const DerivatorType &derivator, MeasurementModel measurementModel,
+                                 const EigenBase<Derived> &R, const Measurement &z, const Variables &...variables) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            typename Workspace::Scope workspaceScope(workspace);
+            //The jacobian matrix to be calculated from the measurement model
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //The result of the measurement model with a dual component vector added to the state
+            auto input = h(seededState(derivator));
+            //Calculate the Jacobian and the result of the measurement model
+            update_impl(hx, input, h, H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - hx));
+        }
+
+        /**
+         * The type of the Innovation covariance for a Measurement Jacobian
+         * @tparam DerivedH Type of the Measurement Jacobian
+         */
+        template<typename DerivedH>
+        using InnovationCovarianceOf = AutoMatrix<DerivedH::RowsAtCompileTime, DerivedH::RowsAtCompileTime>;
+
+        /**
+         * Applies the Kalman Update with a linearized Measurement Model
+         *
+         * The Innovation covariance is factorized once with a Cholesky decomposition instead of being inverted and P*H^T
+         * is reused for the Innovation covariance, the Kalman Gain and the Covariance update.
+         * @tparam DerivedH Type of the Measurement Jacobian
+         * @tparam Derived Type of the Measurement Noise Covariance
+         * @tparam Innovation Type of the Innovation (Vector or Scalar)
+         * @param H The Jacobian of the Measurement Model at mu
+         * @param R Additive Measurement Noise Covariance
+         * @param delta The Innovation z-h(mu)
+         * @param log_likelihood output: the log likelihood of the Innovation, not calculated if nullptr
+         * @param active The state indices of the columns of H, H has DOF columns if nullptr
+         * @param gate The measurement is rejected before the Kalman Gain is formed if its NIS exceeds this
+         * @return Whether the measurement was applied and its NIS, which is only calculated if gate is finite
+         */
+        template<typename DerivedH, typename Derived, typename Innovation>
+        GateResult correct(const MatrixBase<DerivedH> &H, const MatrixBase<Derived> &R, const Innovation &delta,
+                           double *log_likelihood = nullptr, const std::vector<Index> *active = nullptr,
+                           ScalarType gate = std::numeric_limits<ScalarType>::infinity()) {
+            bool const gated = gate < std::numeric_limits<ScalarType>::infinity();
+            //Uncorrelated components are cheaper to process one after another, the gate needs the joint NIS though
+            if (!gated && (DerivedH::RowsAtCompileTime == 1 || R.isDiagonal(ScalarType(0)))) {
+                correctSequential(H, R.diagonal(), delta, log_likelihood, active);
+                return GateResult{true, 0.};
+            }
+            static constexpr int MDOF = DerivedH::RowsAtCompileTime;
+            typename Workspace::Scope workspaceScope(workspace);
+            auto &buffers = workspace.innovation(H.rows());
+            //P*H^T is needed for the Innovation covariance, the Kalman Gain and the Covariance update
+            AutoMatrix<DOF, MDOF> localPHt;
+            auto &PHt = workspace.select(localPHt, buffers.PHt);
+            if (active) {
+                //Summed up by columns of H since Eigen would copy the columns of sigma for a matrix product
+                PHt.setZero(DOF, H.rows());
+                for (Index j = 0; j < H.cols(); ++j)
+                    PHt.noalias() += sigma.col((*active)[j]) * H.col(j).transpose();
+            } else
+                PHt.noalias() = sigma * H.transpose();
+            //Calculate the Innovation covariance S=H*P*H^T+R
+            InnovationCovarianceOf<DerivedH> localS;
+            auto &S = workspace.select(localS, buffers.S);
+            S = R;
+            if (active) {
+                for (Index j = 0; j < H.cols(); ++j)
+                    S.noalias() += H.col(j) * PHt.row((*active)[j]);
+            } else
+                S.noalias() += H * PHt;
+            //Factorize the Innovation covariance
+            LLT<InnovationCovarianceOf<DerivedH>> localLLT;
+            auto &llt = workspace.select(localLLT, buffers.llt);
+            llt.compute(S);
+            assert(llt.info() == Success && "The innovation covariance has to be positive definite");
+            //The whitened Innovation L^-1*delta, its squared norm is the NIS
+            MatrixType<MDOF, 1> localWhitened;
+            auto &whitened = workspace.select(localWhitened, buffers.whitened);
+            whitened = asVector(delta);
+            llt.matrixL().solveInPlace(whitened);
+            if (log_likelihood)
+                *log_likelihood = logLikelihood(llt, whitened);
+            GateResult const result{true, gated ? double(whitened.squaredNorm()) : 0.};
+            //Outliers are rejected before the Kalman Gain is formed, mu and sigma stay untouched
+            if (gated && !(result.nis <= gate))
+                return GateResult{false, result.nis};
+            //Whiten H*P with the Cholesky factor S=L*L^T: W=L^-1*H*P, so K=W^T*L^-1 and K*H*P=W^T*W is symmetric
+            AutoMatrix<MDOF, DOF> localW;
+            auto &W = workspace.select(localW, buffers.W);
+            W = PHt.transpose();
+            llt.matrixL().solveInPlace(W);
+            //Calcualte the updated state estimate and covariance estimate
+            add_diff(mu, W.transpose() * whitened, W.transpose());
+            return result;
+        }
+
+        /**
+         * Applies the Kalman Update with a linearized Measurement Model and diagonal Measurement Noise
+         * @tparam DerivedH Type of the Measurement Jacobian
+         * @tparam Derived Type of the Measurement Noise Covariance
+         * @tparam Innovation Type of the Innovation (Vector or Scalar)
+         * @param H The Jacobian of the Measurement Model at mu
+         * @param R Additive diagonal Measurement Noise Covariance
+         * @param delta The Innovation z-h(mu)
+         * @param log_likelihood output: the log likelihood of the Innovation, not calculated if nullptr
+         * @param active The state indices of the columns of H, H has DOF columns if nullptr
+         * @param gate The measurement is rejected before the Kalman Gain is formed if its NIS exceeds this
+         * @return Whether the measurement was applied and its NIS, which is only calculated if gate is finite
+         */
+        template<typename DerivedH, typename Derived, typename Innovation>
+        GateResult correct(const MatrixBase<DerivedH> &H, const DiagonalBase<Derived> &R, const Innovation &delta,
+                           double *log_likelihood = nullptr, const std::vector<Index> *active = nullptr,
+                           ScalarType gate = std::numeric_limits<ScalarType>::infinity()) {
+            //The NIS needs the joint Innovation covariance
+            if (gate < std::numeric_limits<ScalarType>::infinity())
+                return correct(H, InnovationCovarianceOf<DerivedH>(R), delta, log_likelihood, active, gate);
+            correctSequential(H, R.diagonal(), delta, log_likelihood, active);
+            return GateResult{true, 0.};
+        }
+
+        /**
+         * Applies the Kalman Update for uncorrelated Measurement Noise component by component
+         *
+         * Each component is a scalar measurement, so the Innovation covariance is a scalar and the Covariance is
+         * updated by a rank 1 outer product. All components are linearized at the prior State Estimate, so the result
+         * equals the joint update.
+         * @tparam DerivedH Type of the Measurement Jacobian
+         * @tparam DerivedR Type of the Vector of Measurement Noise Variances
+         * @tparam Innovation Type of the Innovation (Vector or Scalar)
+         * @param H The Jacobian of the Measurement Model at mu
+         * @param variances The variances of the Measurement components
+         * @param delta The Innovation z-h(mu)
+         * @param log_likelihood output: the log likelihood of the Innovation, not calculated if nullptr
+         * @param active The state indices of the columns of H, H has DOF columns if nullptr
+         */
+        template<typename DerivedH, typename DerivedR, typename Innovation>
+        void correctSequential(const MatrixBase<DerivedH> &H, const MatrixBase<DerivedR> &variances,
+                               const Innovation &delta, double *log_likelihood,
+                               const std::vector<Index> *active = nullptr) {
+            auto &&innovation = asVector(delta);
+            //The correction of the State Estimate
+            MatrixType<DOF, 1> diff = MatrixType<DOF, 1>::Zero();
+            //P*h^T and the Kalman Gain of the current component
+            MatrixType<DOF, 1> Ph, k;
+            if (log_likelihood)
+                *log_likelihood = 0;
+            for (Index i = 0; i < H.rows(); ++i) {
+                //The Innovation variance of the component and its Innovation after the previous corrections
+                ScalarType s, residual;
+                if (active) {
+                    Ph.noalias() = sigma(all, viewOf(*active)) * H.row(i).transpose();
+                    s = H.row(i).dot(Ph(viewOf(*active))) + variances(i);
+                    residual = innovation(i) - H.row(i).dot(diff(viewOf(*active)));
+                } else {
+                    Ph.noalias() = sigma * H.row(i).transpose();
+                    s = H.row(i).dot(Ph) + variances(i);
+                    residual = innovation(i) - H.row(i).dot(diff);
+                }
+                assert(s > 0 && "The innovation variance has to be positive");
+                diff += Ph * (residual / s);
+                //The outer product of a vector with itself is exactly symmetric, unlike k*Ph^T
+                k = Ph / std::sqrt(s);
+                sigma.noalias() -= k * k.transpose();
+                if (log_likelihood)
+                    *log_likelihood -= 0.5 * (residual * residual / s + std::log(s) + std::log(2 * M_PI));
+            }
+            //The Covariance is already corrected, only move it to the new State Estimate
+            add_diff(mu, diff, MatrixType<DOF, 0>());
+        }
+
+        /**
+         * Sets the Covariance to A*P*A^T
+         *
+         * Rows of A which are unit vectors, e.g. for biases or landmarks which a dynamic model does not change, are
+         * detected from their entries. If at most half of the rows are changed, only the changed rows and columns N of
+         * the Covariance are transformed: sigma_N=A_N*P and sigma_NN=A_N*P*A_N^T. This costs O(|N|*DOF^2) instead of
+         * O(DOF^3). Otherwise only the lower triangle of the dense result is calculated and then mirrored, so the
+         * Covariance stays exactly symmetric in both cases.
+         * @tparam DerivedA Type of the Transformation
+         * @tparam DerivedP Type of the transformed Covariance
+         * @param A The Jacobian of the Transformation
+         * @param P The Covariance to be transformed, only its lower triangle is read, may be sigma itself
+         */
+        template<typename DerivedA, typename DerivedP>
+        void transformCovariance(const MatrixBase<DerivedA> &A, const MatrixBase<DerivedP> &P) {
+            typename Workspace::Scope workspaceScope(workspace);
+            Covariance localAP;
+            auto &AP = workspace.select(localAP, workspace.AP);
+            //Find the rows of A which are not unit vectors
+            changedRows.clear();
+            for (Index i = 0; i < A.rows(); ++i) {
+                bool unit = A(i, i) == ScalarType(1);
+                for (Index j = 0; unit && j < A.cols(); ++j)
+                    unit = j == i || A(i, j) == ScalarType(0);
+                if (!unit)
+                    changedRows.push_back(i);
+            }
+            Index const n = changedRows.size();
+            if (2 * n > DOF) {
+                AP.noalias() = A * P.template selfadjointView<Lower>();
+                sigma.template triangularView<Lower>() = AP * A.transpose();
+                symmetrizeFromLower(sigma);
+                return;
+            }
+            //The changed rows of A and their product with P share the buffer of A*P
+            AP.resize(DOF, DOF);
+            auto AN = AP.topRows(n);
+            auto ANP = AP.bottomRows(n);
+            for (Index i = 0; i < n; ++i)
+                AN.row(i) = A.row(changedRows[i]);
+            ANP.noalias() = AN * P.template selfadjointView<Lower>();
+            //The unchanged part of the Covariance is P itself
+            if (static_cast<const void *>(&P.derived()) != static_cast<const void *>(&sigma))
+                sigma.template triangularView<Lower>() = P;
+            symmetrizeFromLower(sigma);
+            for (Index i = 0; i < n; ++i) {
+                sigma.row(changedRows[i]) = ANP.row(i);
+                sigma.col(changedRows[i]) = ANP.row(i).transpose();
+            }
+            for (Index i = 0; i < n; ++i)
+                for (Index j = 0; j <= i; ++j)
+                    sigma(changedRows[j], changedRows[i]) = sigma(changedRows[i], changedRows[j]) = ANP.row(i).dot(AN.row(j));
+        }
+
+        /**
+         * Calculates the log likelihood of an Innovation from the Cholesky factor L of its covariance
+         *
+         * log p(delta) = -0.5 * (|L^-1*delta|^2 + 2*sum(log(diag(L))) + n*log(2*pi))
+         * @param S The Cholesky decomposition of the Innovation covariance
+         * @param whitened The Innovation in coordinates where its covariance is the identity, L^-1*delta
+         * @return The log likelihood
+         */
+        template<typename Factorization, typename Derived>
+        static ScalarType logLikelihood(const Factorization &S, const MatrixBase<Derived> &whitened) {
+            return ScalarType(-0.5) * (whitened.squaredNorm() + 2 * S.matrixLLT().diagonal().array().log().sum()
+                                       + S.rows() * std::log(2 * M_PI));
+        }
+
+        /**
+         * Views a scalar Innovation as a vector of size 1
+         */
+        template<typename Derived>
+        static const Derived &asVector(const MatrixBase<Derived> &delta) {
+            return delta.derived();
+        }
+
+        static Matrix<ScalarType, 1, 1> asVector(const ScalarType &delta) {
+            return Matrix<ScalarType, 1, 1>::Constant(delta);
+        }
+
+        /**
+         * Differentiates a model at mu in chunks of K Jacobian columns
+         *
+         * For each chunk, the model is evaluated with a dual component vector whose Jets only have non zero
+         * derivatives for the K columns of the chunk.
+         * @tparam K The number of Jacobian columns per evaluation
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @tparam Derived Type of the Jacobian
+         * @param model The Model g(x)
+         * @param reference The result g(mu), the Jacobian is calculated for g(mu+delta)-g(mu)
+         * @param J The resulting Jacobian
+         */
+        template<int K, typename Model, typename Result, typename Derived>
+        void differentiateChunked(Model model, const Result &reference, MatrixBase<Derived> &J) {
+            using ChunkJet = ceres::Jet<ScalarType, K>;
+            static_assert(!ChunkJet::dynamic, "Chunk Jets have to be fixed size, increase USE_EIGEN_DYNAMIC_THRESHHOLD or reduce K");
+            //The dual component vector of the current chunk
+            Matrix<ChunkJet, DOF, 1> derivator;
+            derivator.setZero();
+            for (int column = 0; column < DOF; column += K) {
+                //The number of columns of this chunk, the last one may be smaller
+                int const width = std::min(K, DOF - column);
+                for (int j = 0; j < width; ++j)
+                    derivator[column + j].v[j] = 1;
+                //The difference to the reference contains the derivatives of the chunk
+                auto diff = eval(model(eval(mu + derivator)) - reference);
+                for (int i = 0; i < J.rows(); ++i)
+                    J.block(i, column, 1, width) = jetOf(diff, i).v.head(width).transpose();
+                for (int j = 0; j < width; ++j)
+                    derivator[column + j].v[j] = 0;
+            }
+        }
+
+        /**
+         * Differentiates a model at mu with respect to the entries of an active subspace in chunks of K
+         * @tparam K The number of Jacobian columns per evaluation
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @tparam Derived Type of the Jacobian
+         * @param model The Model g(x)
+         * @param reference The result g(mu), the Jacobian is calculated for g(mu+delta)-g(mu)
+         * @param active The indices of the state, column j of J belongs to active[j]
+         * @param J The resulting Jacobian with one column per active index
+         */
+        template<int K, typename Model, typename Result, typename Derived>
+        void differentiateActive(Model model, const Result &reference, const std::vector<Index> &active,
+                                 MatrixBase<Derived> &J) {
+            using ChunkJet = ceres::Jet<ScalarType, K>;
+            static_assert(!ChunkJet::dynamic, "Chunk Jets have to be fixed size, increase USE_EIGEN_DYNAMIC_THRESHHOLD or reduce K");
+            //The dual component vector of the current chunk
+            Matrix<ChunkJet, DOF, 1> derivator;
+            derivator.setZero();
+            int const columns = active.size();
+            for (int column = 0; column < columns; column += K) {
+                //The number of columns of this chunk, the last one may be smaller
+                int const width = std::min(K, columns - column);
+                for (int j = 0; j < width; ++j)
+                    derivator[active[column + j]].v[j] = 1;
+                //The difference to the reference contains the derivatives of the chunk
+                auto diff = eval(model(eval(mu + derivator)) - reference);
+                for (int i = 0; i < J.rows(); ++i)
+                    J.block(i, column, 1, width) = jetOf(diff, i).v.head(width).transpose();
+                for (int j = 0; j < width; ++j)
+                    derivator[active[column + j]].v[j] = 0;
+            }
+        }
+
+        /**
+         * Sets the Covariance to F*sigma*F^T for a Jacobian F which equals the identity outside an active subspace
+         *
+         * Only the rows and columns of the active subspace change: sigma_AA=F_AA*sigma_AA*F_AA^T and
+         * sigma_AB=F_AA*sigma_AB for the passive entries B.
+         * @tparam DerivedF Type of the Jacobian in the active subspace
+         * @param active The sorted indices of the active subspace
+         * @param FAA The Jacobian in the active subspace
+         */
+        template<typename DerivedF>
+        void transformActiveCovariance(const std::vector<Index> &active, const MatrixBase<DerivedF> &FAA) {
+            typename Workspace::Scope workspaceScope(workspace);
+            Index const n = active.size();
+            Covariance localAP, localP;
+            auto &AP = workspace.select(localAP, workspace.AP);
+            auto &P = workspace.select(localP, workspace.P);
+            AP.resize(DOF, DOF);
+            P.resize(DOF, DOF);
+            auto A = viewOf(active);
+            //The transformed rows of the active subspace F_AA*sigma_A, summed up by columns of F_AA since Eigen
+            //would copy sigma_A for a matrix product
+            auto FP = AP.topRows(n);
+            FP.setZero();
+            for (Index j = 0; j < n; ++j)
+                FP.noalias() += FAA.col(j) * sigma.row(active[j]);
+            auto PAA = P.topLeftCorner(n, n);
+            PAA.setZero();
+            for (Index j = 0; j < n; ++j)
+                PAA.noalias() += FP.col(active[j]) * FAA.col(j).transpose();
+            symmetrizeFromLower(PAA);
+            sigma(A, all) = FP;
+            sigma(all, A) = FP.transpose();
+            sigma(A, A) = PAA;
+        }
+
+        /**
+         * Returns mu with the dual component vector added, the same as eval(mu + getDerivator<DOF, ScalarType>())
+         *
+         * The result is kept between calls. Its derivatives are only set on the first call, afterwards the values of
+         * the vector entries are overwritten with mu and only the manifold members are added to their dual components
+         * again. The result must not be changed, models which change their argument have to work on a copy.
+         * @return The seeded state
+         */
+        const SeededState &seededState() {
+            if (!seededMu) {
+                //The seeded state outlives the step, so it must not be stored in a JetArena
+                ceres::JetArena::Suspend heapOnly;
+                seededMu.emplace(eval(mu + getDerivator<DOF, ScalarType>()));
+            } else
+                refreshSeeds(mu, *seededMu);
+            return *seededMu;
+        }
+
+        /**
+         * Returns mu with a dual component vector added, the kept seeded state for the dense dual components
+         * @param derivator The dual component vector
+         * @return The seeded state
+         */
+        template<typename DerivatorType>
+        decltype(auto) seededState(const DerivatorType &derivator) {
+            if constexpr (std::is_same_v<DerivatorType, std::decay_t<decltype(getDerivator<DOF, ScalarType>())>>)
+                return seededState();
+            else
+                return eval(mu + derivator);
+        }
+
+        /**
+         * Writes the values of a vector State into the seeded state
+         * @param seeded The seeded state
+         */
+        template<typename Derived>
+        void refreshSeeds(const MatrixBase<Derived> &, SeededState &seeded) {
+            for (int i = 0; i < DOF; ++i)
+                seeded[i].a = mu[i];
+        }
+
+        /**
+         * Writes the values of the vector part of a CompoundManifold into the seeded state and adds the dual
+         * components to the manifold members again
+         * @param seeded The seeded state
+         */
+        void refreshSeeds(const CompoundManifold &, SeededState &seeded) {
+            for (unsigned i = 0; i < mu.VEC_DOF; ++i)
+                seeded.vector_part(i).a = mu.vector_part(i);
+            int dof = 0;
+            auto refreshMember = [&](auto &member, auto &seededMember) {
+                int constexpr curDOF = DOFOf<decltype(member)>;
+                auto refreshed = eval(member + getDerivator<DOF, ScalarType>().template segment<curDOF>(dof));
+                //Copy assignment keeps the storage of the seeded Jets
+                seededMember = refreshed;
+                dof += curDOF;
+            };
+            mu.forEachManifoldWithOther(refreshMember, seeded);
+        }
+
+        /**
+         * Adds the dual components to a Manifold State again
+         * @param seeded The seeded state
+         */
+        void refreshSeeds(const Manifold &, SeededState &seeded) {
+            SeededState refreshed = eval(mu + getDerivator<DOF, ScalarType>());
+            //Copy assignment keeps the storage of the seeded Jets
+            seeded = refreshed;
+        }
+
+        /**
+         * Returns the cached sparsity pattern of a model type or traces it on the first call
+         * @tparam ModelType The type which identifies the model, see keyOf
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @param model The Model g(x)
+         * @param reference The result g(mu)
+         * @return The sparsity pattern of the Jacobian of g(mu+delta)-g(mu)
+         */
+        template<typename ModelType, typename Model, typename Result>
+        const SparsityPattern &sparsityOf(Model model, const Result &reference) {
+            auto found = sparsityPatterns.find(keyOf<ModelType>());
+            if (found == sparsityPatterns.end())
+                found = sparsityPatterns.emplace(keyOf<ModelType>(), traceSparsity(model, reference)).first;
+            return found->second;
+        }
+
+        /**
+         * Returns the cached Jacobian of a model type or probes the model on the first call
+         *
+         * The model is differentiated at mu and at a second state which differs in every entry. It counts as linear
+         * if both Jacobians are exactly equal. The Jacobian of a linear model may still depend on the arguments bound to
+         * the model, so it is probed again if they differ from the ones of the probe. A nonlinear model stays nonlinear.
+         * @tparam ModelType The type which identifies the model, see keyOf
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Arguments Types of the Control Vectors or Auxiliary Variables
+         * @param model The Model g(x) with the arguments bound
+         * @param arguments The Control Vectors or Auxiliary Variables bound to the model
+         * @return The constant Jacobian of a linear model, nullptr for nonlinear models
+         */
+        template<typename ModelType, typename Model, typename... Arguments>
+        const MatrixType<Dynamic, Dynamic> *linearJacobianOf(Model model, const Arguments &...arguments) {
+            auto found = linearJacobians.find(keyOf<ModelType>());
+            if (found != linearJacobians.end() && found->second.linear) {
+                //The same model type may be called with other types of arguments
+                const auto *probed = std::any_cast<std::tuple<Arguments...>>(&found->second.arguments);
+                bool equal = probed && std::apply([&arguments...](const auto &...probedArguments) {
+                    return (equalArgument(probedArguments, arguments) && ...);
+                }, *probed);
+                if (!equal) {
+                    linearJacobians.erase(found);
+                    found = linearJacobians.end();
+                }
+            }
+            if (found == linearJacobians.end()) {
+                LinearJacobian probe{false, differentiateAt(model, mu), std::tuple<Arguments...>(arguments...)};
+                //Irregular offsets so that a symmetric nonlinearity does not look linear by chance
+                State other = mu + MatrixType<DOF, 1>(MatrixType<DOF, 1>::LinSpaced(DOF, 1., DOF).cwiseSqrt());
+                probe.linear = !probe.jacobian.hasNaN() && probe.jacobian == differentiateAt(model, other);
+                if (!probe.linear)
+                    probe.jacobian.resize(0, 0);
+                found = linearJacobians.emplace(keyOf<ModelType>(), std::move(probe)).first;
+            }
+            return found->second.linear ? &found->second.jacobian : nullptr;
+        }
+
+        /**
+         * Differentiates a model at an arbitrary state with dense Jets
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @param model The Model g(x)
+         * @param x The state to differentiate at
+         * @return The Jacobian of g(x+delta)-g(x)
+         */
+        template<typename Model>
+        MatrixType<Dynamic, Dynamic> differentiateAt(Model model, const State &x) {
+            //Derivative storage of the Jets for the probe
+            ceres::JetArena::Scope arenaScope(jetArena);
+            auto reference = model(x);
+            auto diff = eval(model(eval(x + getDerivator<DOF, ScalarType>())) - reference);
+            MatrixType<Dynamic, Dynamic> J(DOFOf<decltype(reference)>, DOF);
+            for (int i = 0; i < J.rows(); ++i)
+                assignDerivative(J.row(i), jetOf(diff, i));
+            return J;
+        }
+
+        /**
+         * Predict the State Estimate with the Jets of the precision policy, see predict
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predictMixed(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            beginPrediction();
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
+            JacobianOf<State> localF;
+            auto &F = workspace.select(localF, workspace.F);
+            F.resize(DOF, DOF);
+            //Evaluate the dynamic model on the state with the dual components of the precision policy
+            auto input = seededMixedState();
+            dynamicModel(input, u...);
+            //Calculate the Jacobian Matrix and set the new State Estimate
+            extractMixed(input, F, mu);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the new Covariance
+            transformCovariance(F, sigma);
+            sigma += Q;
+            endPrediction(F);
+        }
+
+        /**
+         * Update the State Estimate with the Jets of the precision policy, see update
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void updateMixed(MeasurementModel measurementModel, const EigenBase<Derived> &R, const Measurement &z,
+                         const Variables &...variables) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
+            JacobianOf<Measurement> localH;
+            auto &H = workspace.select(localH, workspace.innovation(DOFOf<Measurement>).H);
+            H.resize(DOFOf<Measurement>, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //Calculate the Jacobian and the result of the measurement model
+            extractMixed(eval(measurementModel(seededMixedState(), variables...)), H, hx);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Calculate the updated state estimate and covariance
+            correct(H, R.derived(), eval(z - hx));
+        }
+
+        /**
+         * Adds the dense dual components of the precision policy to mu
+         * @return mu with Jets of the precision policy, has to be used within a JetArena::Scope
+         */
+        auto seededMixedState() const {
+            return eval(castTo<JetScalarType>(mu) + getDerivator<mixedJetSize, JetScalarType>().template head<DOF>());
+        }
+
+        /**
+         * Reads the Jacobian and the result of a model evaluated with the Jets of the precision policy
+         * @tparam Output Type of the result of the model
+         * @tparam Result Type of the Result of the Model with the scalar type of the State
+         * @param output The result of the model at seededMixedState()
+         * @param J output: The Jacobian of g(mu+delta)-g(mu), has to be resized already
+         * @param result output: The real part of the output converted to the scalar type of the State, may be mu itself
+         */
+        template<typename Output, typename Derived, typename Result>
+        void extractMixed(const Output &output, MatrixBase<Derived> &J, Result &result) {
+            //The real part of the output is the reference, so manifolds are differentiated at their identity
+            auto value = valueOf(output);
+            if constexpr (std::is_base_of_v<Manifold, Output>) {
+                auto diff = eval(output - value);
+                for (int i = 0; i < J.rows(); ++i)
+                    assignDerivative(J.row(i), jetOf(diff, i));
+            } else {
+                //Vectors and scalars already carry the derivatives in their dual components
+                for (int i = 0; i < J.rows(); ++i)
+                    assignDerivative(J.row(i), jetOf(output, i));
+            }
+            result = castTo<ScalarType>(value);
+        }
+
+        /**
+         * Traces the sparsity pattern of the Jacobian of a model at mu
+         *
+         * Sparse Jets keep entries which are structurally non zero even if their value is zero, so the indices of the
+         * result are the state entries each output depends on.
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @param model The Model g(x)
+         * @param reference The result g(mu)
+         * @return The sparsity pattern of the Jacobian of g(mu+delta)-g(mu)
+         */
+        template<typename Model, typename Result>
+        SparsityPattern traceSparsity(Model model, const Result &reference) {
+            //Derivative storage of the Jets for the trace
+            ceres::JetArena::Scope arenaScope(jetArena);
+            auto diff = eval(model(eval(mu + getSparseDerivator<DOF>())) - reference);
+            std::vector<std::vector<int>> rows(DOFOf<Result>);
+            for (int i = 0; i < DOFOf<Result>; ++i) {
+                const auto &jet = jetOf(diff, i);
+                jet.v.forEach([&](int column, ScalarType) { rows[i].push_back(column); });
+            }
+            return SparsityPattern(std::move(rows), DOF);
+        }
+
+        /**
+         * Differentiates a model at mu with one dual component per color of a sparsity pattern
+         * @tparam K The number of colors per evaluation
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @tparam Derived Type of the Jacobian
+         * @param model The Model g(x)
+         * @param reference The result g(mu), the Jacobian is calculated for g(mu+delta)-g(mu)
+         * @param pattern The sparsity pattern of the Jacobian
+         * @param J The resulting Jacobian
+         */
+        template<int K, typename Model, typename Result, typename Derived>
+        void differentiateColored(Model model, const Result &reference, const SparsityPattern &pattern,
+                                  MatrixBase<Derived> &J) {
+            using ChunkJet = ceres::Jet<ScalarType, K>;
+            static_assert(!ChunkJet::dynamic, "Chunk Jets have to be fixed size, increase USE_EIGEN_DYNAMIC_THRESHHOLD or reduce K");
+            J.setZero();
+            //The dual component vector of the current chunk of colors
+            Matrix<ChunkJet, DOF, 1> derivator;
+            derivator.setZero();
+            for (int first = 0; first < pattern.numColors; first += K) {
+                //All columns of a color share the dual component of the color
+                auto inChunk = [&](int column) {
+                    return pattern.colors[column] >= first && pattern.colors[column] < first + K;
+                };
+                for (int j = 0; j < DOF; ++j)
+                    if (inChunk(j))
+                        derivator[j].v[pattern.colors[j] - first] = 1;
+                auto diff = eval(model(eval(mu + derivator)) - reference);
+                //Each non zero entry is the only one of its color in its row
+                for (int i = 0; i < J.rows(); ++i)
+                    for (int j : pattern.rows[i])
+                        if (inChunk(j))
+                            J(i, j) = jetOf(diff, i).v[pattern.colors[j] - first];
+                for (int j = 0; j < DOF; ++j)
+                    if (inChunk(j))
+                        derivator[j].v[pattern.colors[j] - first] = 0;
+            }
+        }
 
+        /**
+         * Access to the i-th Jet of a model result. Scalar results are a single Jet.
+         */
+        template<typename ResultType>
+        static const auto &jetOf(const ResultType &result, int i) {
+            if constexpr (std::is_base_of_v<EigenBase<ResultType>, ResultType>)
+                return result(i);
+            else
+                return result;
         }
 
+        /**
+         * Differentiates a model at mu in reverse mode
+         *
+         * The model is evaluated once with ReverseJets which record all operations on the tape. Each row of the
+         * Jacobian is the result of a reverse sweep from the corresponding output.
+         * @tparam Model Type of the Model Functor g(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @tparam Derived Type of the Jacobian
+         * @param model The Model g(x)
+         * @param result Set to g(mu) from the recorded values, the Jacobian is calculated for g(mu+delta)-g(mu)
+         * @param J The resulting Jacobian
+         */
+        template<typename Model, typename Result, typename Derived>
+        void differentiateReverse(Model model, Result &result, MatrixBase<Derived> &J) {
+            //The entries of the state are the inputs of the tape
+            typename ceres::ReverseTape<ScalarType>::Scope tapeScope(reverseTape, DOF);
+            auto output = model(eval(mu + getReverseDerivator<DOF>()));
+            //The recorded values are the result of the model
+            result = valueOf(output);
+            //The difference to the result refers to the outputs on the tape
+            auto diff = eval(output - result);
+            for (int i = 0; i < J.rows(); ++i)
+                reverseTape.gradient(jetOf(diff, i).index, J.row(i));
+        }
 
-    private:
+        /**
+         * Differentiates a measurement model at mu in the mode update() would choose
+         *
+         * Reverse mode is used if the measurement has much less DOF than the state (see ADEKF_REVERSE_MODE_RATIO),
+         * otherwise forward mode with the seeded state.
+         * @tparam MeasurementModel Type of the Measurement Model Functor h(x), has to return its result
+         * @tparam Result Type of the Result of the Model
+         * @tparam Derived Type of the Jacobian
+         * @param h The Measurement Model h(x)
+         * @param result Set to h(mu)
+         * @param H The resulting Jacobian
+         */
+        template<typename MeasurementModel, typename Result, typename Derived>
+        void linearize(MeasurementModel h, Result &result, MatrixBase<Derived> &H) {
+            if constexpr (ADEKF_REVERSE_MODE_RATIO > 0 && DOFOf<Result> * ADEKF_REVERSE_MODE_RATIO <= DOF) {
+                differentiateReverse(h, result, H);
+            } else {
+                //Derivative storage of the Jets for this step
+                ceres::JetArena::Scope arenaScope(jetArena);
+                auto input = h(seededState());
+                update_impl(result, input, h, H);
+            }
+        }
 
         /**
         * Calculation of the new Jacobian  for a CompoundManifold as State
@@ -393,7 +2128,7 @@ namespace adekf {
                 //Calculate the Jacobian of the Boxplus Function
                 auto result = manifold - other;
                 for (int i = 0; i < curDOF; ++i) {
-                    F.row(dof + i) = result(i).v;
+                    assignDerivative(F.row(dof + i), result(i));
                 }
                 dof += curDOF;
             };
@@ -401,7 +2136,7 @@ namespace adekf {
             input.forEachManifoldWithOther(calcManifoldJacobian, otherManifold);
             //Read vector part
             for(int i=0; i < input.VEC_DOF; i++){
-                F.row(dof+i)=input.vector_part(i).v;
+                assignDerivative(F.row(dof+i), input.vector_part(i));
             }
         }
 
@@ -411,16 +2146,15 @@ namespace adekf {
          * @tparam DOFandNoise The DOF of the State plus the dimension of a possible Noise Vector
          * @tparam DynamicModel The Type of the Dynamic Model Functor
          * @tparam Manifold The Type of Manifold used as State
-         * @param f The Dynamic Model f(x)
-         * @param input Result of an Addition of the State and a dual component
+         * @param input Result of the Dynamic Model applied on the Addition of the State and a dual component
          * @param F The resulting Jacobian. Calculated with dual numbers
          */
         template<typename Derived, typename DynamicModel, typename ManifoldType>
-        void predict_impl(const Manifold &, DynamicModel f, const ManifoldType &input, MatrixBase<Derived> &F) {
-            //Set the new state estimate
-            f(mu);
+        void predict_impl(const Manifold &, DynamicModel, const ManifoldType &input, MatrixBase<Derived> &F) {
+            //The real parts of the dual numbers are the new state estimate
+            mu = valueOf(input);
             //The difference of a differentiated manifold with it's identity results in the jacobian
-            F=extractJacobi(input-mu);
+            extractJacobi(input - mu, F);
         }
 
 
@@ -429,22 +2163,21 @@ namespace adekf {
        * @tparam Derived The MatrixType of the Covariance
        * @tparam DynamicModel The Type of the Dynamic Model Functor
        * @tparam ManifoldType The Type of Manifold used as State
-       * @param f The Dynamic Model f(x)
-       * @param input Result of an Addition of the State and a dual component
+       * @param input Result of the Dynamic Model applied on the Addition of the State and a dual component
        * @param F The resulting Jacobian. Calculated with dual numbers
        */
         template<typename Derived, typename DynamicModel, typename ManifoldType>
-        void predict_impl(const CompoundManifold &, DynamicModel f, const ManifoldType &input, MatrixBase<Derived> &F) {
+        void predict_impl(const CompoundManifold &, DynamicModel, const ManifoldType &input, MatrixBase<Derived> &F) {
             //check if state is a vector compound manifold
             if(mu.MAN_DOF==0){
                 for (int i = 0; i < DOF; ++i) {
-                    F.row(i) = input.vector_part(i).v;
+                    assignDerivative(F.row(i), input.vector_part(i));
                     mu.vector_part(i) = input.vector_part(i).a;
                 }
                 return;
             }
-            //Set the new state estimate
-            f(mu);
+            //The real parts of the dual numbers are the new state estimate
+            mu = valueOf(input);
             //calculate the Jacobian
             calcJacobianCompoundManifold(input, mu, F);
         }
@@ -463,7 +2196,7 @@ namespace adekf {
             //The real component of the dual numbers are the result of the dynamic model
             //The dual component vectors represent the rows of the jacobian matrix
             for (int i = 0; i < DOF; ++i) {
-                F.row(i) = input[i].v;
+                assignDerivative(F.row(i), input[i]);
                 mu[i] = input[i].a;
             }
         }
@@ -493,15 +2226,14 @@ namespace adekf {
          * @tparam Derived Type of the Covaraince Matrix
          * @param modelResult Result of the Measurement Model
          * @param input Result of the Measurement Model with a dual compnent added to the state
-         * @param h The Measurement Model h(x)
          * @param H The resulting Jacobian. Calculated with dual numbers
          */
         template<typename Measurement, typename ModelReturn, typename MeasurementModel, typename Derived>
         void
-        update_impl_(const CompoundManifold &, Measurement &modelResult, const ModelReturn &input, MeasurementModel h,
+        update_impl_(const CompoundManifold &, Measurement &modelResult, const ModelReturn &input, MeasurementModel,
                      MatrixBase<Derived> &H) {
-            //Set the observation to the result of the measurement model
-            modelResult = h(mu);
+            //The real parts of the dual numbers are the result of the measurement model
+            modelResult = valueOf(input);
             //calculate the Jacobian
             calcJacobianCompoundManifold(input, modelResult, H);
         }
@@ -514,17 +2246,16 @@ namespace adekf {
          * @tparam Derived Type of the Covaraince Matrix
          * @param modelResult Result of the Measurement Model
          * @param input Result of the Measurement Model with a dual compnent added to the state
-         * @param h The Measurement Model h(x)
          * @param H The resulting Jacobian. Calculated with dual numbers
          */
         template<typename Measurement, typename ModelReturn, typename MeasurementModel, typename Derived>
         void
-        update_impl_(const Manifold &, Measurement &modelResult, const ModelReturn &input, MeasurementModel h,
+        update_impl_(const Manifold &, Measurement &modelResult, const ModelReturn &input, MeasurementModel,
                      MatrixBase<Derived> &H) {
-            //Set the observation to the result of the measurement model
-            modelResult = h(mu);
+            //The real parts of the dual numbers are the result of the measurement model
+            modelResult = valueOf(input);
             //calculate the Jacobian
-            H=extractJacobi(input - modelResult);
+            extractJacobi(input - modelResult, H);
 
         }
 
@@ -546,7 +2277,7 @@ namespace adekf {
             //The real component of the dual numbers are the result of the measurement model
             //The dual component vectors represent the rows of the jacobian matrix
                 for (int i = 0; i < MDOF; ++i) {
-                    H.row(i) = input[i].v;
+                    assignDerivative(H.row(i), input[i]);
                     modelResult[i] = input[i].a;
                 }
             }
@@ -563,60 +2294,70 @@ namespace adekf {
         * @param h The Measurement Model h(x)
         * @param H The resulting Jacobian. Calculated with dual numbers
         */
-        template<typename MeasurementModel, typename Derived>
-        void update_impl_(const ScalarType &, ScalarType &modelResult, const ceres::Jet<ScalarType,DOF> &input, MeasurementModel,
+        template<typename MeasurementModel, typename Derived, template<typename, int> class Dual>
+        void update_impl_(const ScalarType &, ScalarType &modelResult, const Dual<ScalarType,DOF> &input, MeasurementModel,
                           MatrixBase<Derived> &H) {
             //The real component of the dual numbers are the result of the measurement model
             //The dual component vectors represent the rows of the jacobian matrix
-            H.row(0) = input.v;
+            assignDerivative(H.row(0), input);
             modelResult = input.a;
         }
 
         /**
          * Add an Offset to the Estimated State, if the State is a Manifold
          * @tparam Manifold The Type of Manifold used as State
-         * @tparam Derived The Type of Matrix used as the Result of K*H
+         * @tparam Derived The Type of the factor of K*H*sigma
          * @param diff The Difference to be added to the state
-         * @param KH The Multiplication of Kalman Gain and Measurement-Jacobian
+         * @param U A factor of the Multiplication of Kalman Gain, Measurement-Jacobian and Covariance K*H*sigma=U*U^T
          */
         template<typename Derived>
-        void add_diff(const Manifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &KH) {
+        void add_diff(const Manifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &U) {
+            //Derivative storage of the Jets of the Boxplus Jacobian
+            ceres::JetArena::Scope arenaScope(jetArena);
+            typename Workspace::Scope workspaceScope(workspace);
             //Add the Difference on the Estimated State
             State newMu = mu + diff;
             //Calculate the Jacobian of the Boxplus Function
-            JacobianOf<State> D=transformReferenceJacobian(mu,newMu,diff);
+            JacobianOf<State> localD;
+            auto &D = workspace.select(localD, workspace.D);
+            D.resize(DOF, DOF);
+            transformReferenceJacobian(mu, newMu, diff, D);
             //Set the new Estimated Value
             mu = newMu;
             //Calculate the new Covariance Matrix
-            sigma = D * (sigma - (KH * sigma)) * D.transpose();
+            moveCovariance(D, U);
         }
 
 
         /**
         * Add an Offset to the Estimated State, if the State is a CompoundManifold
          *
-         * For CompoundManifolds we can optimise the Jacobian D, since each derivative is only dependent on one substate
+         * For CompoundManifolds we can optimise the Jacobian D, since each derivative is only dependent on one substate.
+        * D is the identity on the vector part and is only applied to the rows and columns of the manifold members.
         * @tparam Manifold The Type of Manifold used as State
-        * @tparam Derived The Type of Matrix used as the Result of K*H
+        * @tparam Derived The Type of the factor of K*H*sigma
         * @param diff The Difference to be added to the state
-        * @param KH The Multiplication of Kalman Gain and Measurement-Jacobian
+        * @param U A factor of the Multiplication of Kalman Gain, Measurement-Jacobian and Covariance K*H*sigma=U*U^T
         */
         template<typename Derived>
-        void add_diff(const CompoundManifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &KH) {
+        void add_diff(const CompoundManifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &U) {
             //check if compoundManifold is simple vector this may look a bit dirty but it allows to use the ADEKF_MANIFOLD for vector parts only without significant speed loss
             if(mu.MAN_DOF==0){
-                add_diff<Derived>(diff,diff,KH);
+                add_diff<Derived>(diff,diff,U);
                 return;
             }
 
             //Add the Difference on the Estimated State
             State newMu = mu + diff;
-            //Calculate  the Jacobian of the Boxplus Function
-            JacobianOf<State> D = transformReferenceJacobian(mu,newMu,diff);
+            //Reduce the Covariance, only its lower triangle is updated and then mirrored
+            if (U.cols() > 0) {
+                sigma.template selfadjointView<Lower>().rankUpdate(U, -1);
+                symmetrizeFromLower(sigma);
+            }
+            //The Jacobian of the Boxplus Function is block diagonal, so it is applied block-wise
+            transformReferenceCovariance(mu, newMu, diff, sigma);
             //Set the new Estimated Value
             mu = newMu;
-            //Calculate the new Covariance Matrix
-            sigma = D * (sigma - (KH * sigma)) * D.transpose();
         }
 
         /**
@@ -624,15 +2365,15 @@ namespace adekf {
        *
        * For CompoundManifolds we can optimise the Jacobian D, since each derivative is only dependent on one substate
       * @tparam Manifold The Type of Manifold used as State
-      * @tparam Derived The Type of Matrix used as the Result of K*H
+      * @tparam Derived The Type of the factor of K*H*sigma
       * @param diff The Difference to be added to the state
-      * @param KH The Multiplication of Kalman Gain and Measurement-Jacobian
+      * @param U A factor of the Multiplication of Kalman Gain, Measurement-Jacobian and Covariance K*H*sigma=U*U^T
       */
         template<typename Derived, typename Nullspace>
-        void add_diff(const CompoundManifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &KH, const MatrixBase<Nullspace> & N )   {
+        void add_diff(const CompoundManifold &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &U, const MatrixBase<Nullspace> & N )   {
             //check if compoundManifold is simple vector this may look a bit dirty but it allows to use the ADEKF_MANIFOLD for vector parts only without significant speed loss
             if(mu.MAN_DOF==0){
-                add_diff<Derived>(diff,diff,KH);
+                add_diff<Derived>(diff,diff,U);
                 return;
             }
 
@@ -646,22 +2387,44 @@ namespace adekf {
             //nullspace constraint
             D=D-(D*N-N)*(N.transpose()*N).inverse()*N.transpose();
             //Calculate the new Covariance Matrix
-            sigma = D * (sigma - (KH * sigma)) * D.transpose();
+            moveCovariance(D, U);
         }
 
 
         /**
          * Add an Offset to the Estimated State, if the Statesigma is a Matrix
-         * @tparam Derived The Type of Matrix used as the Result of K*H
+         * @tparam Derived The Type of the factor of K*H*sigma
          * @param diff The Difference to be added to the state
-         * @param KH The Multiplication of Kalman Gain and Measurement-Jacobian
+         * @param U A factor of the Multiplication of Kalman Gain, Measurement-Jacobian and Covariance K*H*sigma=U*U^T
          */
         template<typename Derived>
-        void add_diff(const MatrixType<DOF, 1> &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &KH) {
+        void add_diff(const MatrixType<DOF, 1> &, const MatrixType<DOF, 1> &diff, const MatrixBase<Derived> &U) {
             //Add the Difference on the State
             mu = mu + diff;
-            //Calculate the new Covariance
-            sigma = sigma - (KH * sigma);
+            //Calculate the new Covariance, only its lower triangle is updated and then mirrored
+            if (U.cols() > 0) {
+                sigma.template selfadjointView<Lower>().rankUpdate(U, -1);
+                symmetrizeFromLower(sigma);
+            }
+        }
+
+        /**
+         * Sets the Covariance to D*(sigma-U*U^T)*D^T after the State Estimate was moved by the Boxplus Function
+         * @tparam DerivedD Type of the Boxplus Jacobian
+         * @tparam Derived The Type of the factor of K*H*sigma
+         * @param D The Jacobian of the Boxplus Function
+         * @param U A factor of the Multiplication of Kalman Gain, Measurement-Jacobian and Covariance K*H*sigma=U*U^T
+         */
+        template<typename DerivedD, typename Derived>
+        void moveCovariance(const MatrixBase<DerivedD> &D, const MatrixBase<Derived> &U) {
+            typename Workspace::Scope workspaceScope(workspace);
+            Covariance localP;
+            auto &P = workspace.select(localP, workspace.P);
+            P = sigma;
+            //Only the lower triangle is read by transformCovariance
+            if (U.cols() > 0)
+                P.template selfadjointView<Lower>().rankUpdate(U, -1);
+            transformCovariance(D, P);
         }
 
 
@@ -675,4 +2438,401 @@ namespace adekf {
     template<typename DERIVED, typename COV_TYPE>
     ADEKF(const DERIVED &, const COV_TYPE &) -> ADEKF<typename StateInfo<DERIVED>::type>;
 
+    template<typename DERIVED, typename COV_TYPE>
+    ADEKF(const DERIVED &, const COV_TYPE &, bool) -> ADEKF<typename StateInfo<DERIVED>::type>;
+
+
+    /**
+     * A square root variant of the ADEKF which stores a Cholesky factor of the Covariance instead of the Covariance
+     *
+     * The time update triangularizes [F*L, sqrt(Q)] with a QR decomposition and the measurement update downdates L
+     * with one rank 1 downdate per measurement DOF. If rounding errors would make a downdate indefinite, the update is
+     * triangularized in Joseph form instead. The Covariance L*L^T stays positive definite by construction, so the filter
+     * also works in single precision and never needs assurePositiveDefinite.
+     * The Jacobians are differentiated exactly as in the ADEKF.
+     * @tparam State The State to be used for estimation
+     */
+    template<typename State>
+    class SqrtADEKF : private ADEKF<State> {
+        using Base = ADEKF<State>;
+        /**
+         * The DOF of the State
+         */
+        static constexpr int DOF = DOFOf<State>;
+        using typename Base::ScalarType;
+        template<typename T>
+        using JacobianOf = typename Base::template JacobianOf<T>;
+        template<int N, int M>
+        using MatrixType = typename Base::template MatrixType<N, M>;
+
+    public:
+        /**
+         * The Covariance type of the State
+         */
+        using Covariance = typename Base::Covariance;
+
+        using Base::mu;
+        using Base::jetArena;
+
+        /**
+         * The lower triangular Cholesky factor L of the Covariance sigma=L*L^T
+         */
+        Covariance sqrtSigma;
+
+        /**
+         * Constructor of the SqrtADEKF
+         * @param _mu Initial Expected Value of the State
+         * @param _sigma Initial Covariance of the State, has to be positive definite
+         */
+        SqrtADEKF(const State &_mu, const Covariance &_sigma) : Base(_mu, Base::unusedCovariance()) {
+            LLT<Covariance> llt(_sigma);
+            assert(llt.info() == Success && "The initial covariance has to be positive definite");
+            sqrtSigma = llt.matrixL();
+        }
+
+        /**
+         * @return The Covariance of the State L*L^T
+         */
+        Covariance covariance() const {
+            return sqrtSigma * sqrtSigma.transpose();
+        }
+
+        /**
+         * Predict the State Estimate with automatically differentiated Jacobian Matrices
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance, may be positive semi definite
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predict(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //The Jacobian to be calculated from the dynamic Model
+            JacobianOf<State> F(DOF, DOF);
+            //Bind the control vectors to the dynamic Model
+            auto f = std::bind(dynamicModel, _1, u...);
+            //Add a dual component vector to the state
+            auto input = eval(mu + getDerivator<DOF, ScalarType>());
+            //Evaluate the dynamic model
+            f(input);
+            //Calculate the Jacobian Matrix and set the new State Estimate
+            this->predict_impl(input, f, input, F);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //F*P*F^T+Q = [F*L, sqrt(Q)] * [F*L, sqrt(Q)]^T
+            MatrixType<-1, -1> A(DOF, 2 * DOF);
+            A << F * sqrtSigma.template triangularView<Lower>(), squareRoot(Q);
+            sqrtSigma = triangularFactor(A);
+        }
+
+        /**
+         * Update the State Estimate with automatically differentiated Jacobian Matrices
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance, has to be positive definite
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void update(MeasurementModel measurementModel, const MatrixBase<Derived> &R, const Measurement &z,
+                    const Variables &...variables) {
+            static constexpr int MDOF = DOFOf<Measurement>;
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            //The jacobian matrix to be calculated from the measurement model
+            JacobianOf<Measurement> H(MDOF, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //The result of the measurement model with a dual component vector added to the state
+            auto input = h(this->seededState());
+            //Calculate the Jacobian and the result of the measurement model
+            this->update_impl(hx, input, h, H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //The Innovation covariance is S = [H*L, sqrt(R)] * [H*L, sqrt(R)]^T
+            auto HL = (H * sqrtSigma.template triangularView<Lower>()).eval();
+            MatrixType<-1, -1> A(MDOF, DOF + MDOF);
+            A << HL, squareRoot(R);
+            MatrixType<-1, -1> sqrtS = triangularFactor(A);
+            //U=K*sqrt(S)=L*(H*L)^T*sqrt(S)^-T, so that K*S*K^T=U*U^T
+            MatrixType<-1, -1> U = sqrtSigma.template triangularView<Lower>() *
+                                   sqrtS.template triangularView<Lower>().solve(HL).transpose();
+            //K*(z-h(mu))=U*sqrt(S)^-1*(z-h(mu))
+            MatrixType<DOF, 1> diff = U * sqrtS.template triangularView<Lower>().solve(Base::asVector(eval(z - hx)));
+            //P-K*S*K^T with one downdate per measurement DOF
+            Covariance prior = sqrtSigma;
+            bool definite = true;
+            for (int i = 0; i < MDOF && definite; ++i)
+                definite = choleskyDowndate(sqrtSigma, U.col(i));
+            if (!definite) {
+                //Rounding errors made the downdate indefinite, e.g. for precise measurements in single precision.
+                //The Joseph form (I-K*H)*P*(I-K*H)^T+K*R*K^T = [(I-K*H)*L, K*sqrt(R)] * [(I-K*H)*L, K*sqrt(R)]^T is
+                //positive definite by construction, K=U*sqrt(S)^-1
+                MatrixType<-1, -1> K = sqrtS.template triangularView<Lower>().transpose().solve(U.transpose()).transpose();
+                MatrixType<-1, -1> B(DOF, DOF + MDOF);
+                B << prior - K * (H * prior), K * squareRoot(R);
+                sqrtSigma = triangularFactor(B);
+            }
+            //Set the new State Estimate
+            move(diff);
+        }
+
+    private:
+        /**
+         * Adds an Offset to the Estimated State and moves the Cholesky factor to the new Estimate
+         * @param diff The Difference to be added to the state
+         */
+        void move(const MatrixType<DOF, 1> &diff) {
+            //Add the Difference on the Estimated State
+            State newMu = mu + diff;
+            if constexpr (std::is_base_of<Manifold, State>::value || std::is_base_of<CompoundManifold, State>::value) {
+                //Calculate the Jacobian of the Boxplus Function
+                JacobianOf<State> D(DOF, DOF);
+                transformReferenceJacobian(mu, newMu, diff, D);
+                //D*P*D^T = (D*L)*(D*L)^T
+                sqrtSigma = triangularFactor(D * sqrtSigma.template triangularView<Lower>());
+            }
+            //Set the new Estimated Value
+            mu = newMu;
+        }
+    };
+
+    /**
+     * General Deduction Template for the SqrtADEKF based on StateRetriever.
+     */
+    template<typename DERIVED, typename COV_TYPE>
+    SqrtADEKF(const DERIVED &, const COV_TYPE &) -> SqrtADEKF<typename StateInfo<DERIVED>::type>;
+
+
+    /**
+     * A UD factorized variant of the ADEKF for sensors with scalar or diagonal noise measurements
+     *
+     * The Covariance is stored as sigma=U*diag(d)*U^T with a unit upper triangular U. The time update uses Thornton's
+     * modified weighted Gram-Schmidt orthogonalization and measurements are processed row by row with Bierman's scalar
+     * update. Neither needs a square root or a matrix inverse. Correlated measurement noise is decorrelated with the UD
+     * decomposition of R first. The Jacobians are differentiated exactly as in the ADEKF.
+     * @tparam State The State to be used for estimation
+     */
+    template<typename State>
+    class UDADEKF : private ADEKF<State> {
+        using Base = ADEKF<State>;
+        /**
+         * The DOF of the State
+         */
+        static constexpr int DOF = DOFOf<State>;
+        using typename Base::ScalarType;
+        template<typename T>
+        using JacobianOf = typename Base::template JacobianOf<T>;
+        template<int N, int M>
+        using MatrixType = typename Base::template MatrixType<N, M>;
+
+    public:
+        /**
+         * The Covariance type of the State
+         */
+        using Covariance = typename Base::Covariance;
+
+        using Base::mu;
+        using Base::jetArena;
+
+        /**
+         * The unit upper triangular factor of the Covariance sigma=U*diag(d)*U^T
+         */
+        Covariance U;
+
+        /**
+         * The diagonal factor of the Covariance sigma=U*diag(d)*U^T
+         */
+        MatrixType<DOF, 1> d;
+
+        /**
+         * Constructor of the UDADEKF
+         * @param _mu Initial Expected Value of the State
+         * @param _sigma Initial Covariance of the State
+         */
+        UDADEKF(const State &_mu, const Covariance &_sigma) : Base(_mu, Base::unusedCovariance()), U(DOF, DOF) {
+            udFactor(_sigma, U, d);
+        }
+
+        /**
+         * @return The Covariance of the State U*diag(d)*U^T
+         */
+        Covariance covariance() const {
+            return U * d.asDiagonal() * U.transpose();
+        }
+
+        /**
+         * Predict the State Estimate with automatically differentiated Jacobian Matrices
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         */
+        template<typename DynamicModel, typename... Controls>
+        void predict(DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //The Jacobian to be calculated from the dynamic Model
+            JacobianOf<State> F(DOF, DOF);
+            //Bind the control vectors to the dynamic Model
+            auto f = std::bind(dynamicModel, _1, u...);
+            //Add a dual component vector to the state
+            auto input = eval(mu + getDerivator<DOF, ScalarType>());
+            //Evaluate the dynamic model
+            f(input);
+            //Calculate the Jacobian Matrix and set the new State Estimate
+            this->predict_impl(input, f, input, F);
+            //The dynamic model has to be differentiable
+            assert(!F.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Factorize the process noise Q=G*diag(q)*G^T
+            Covariance G(DOF, DOF);
+            MatrixType<DOF, 1> q;
+            udFactor(Q, G, q);
+            //F*P*F^T+Q = [F*U, G] * diag(d, q) * [F*U, G]^T
+            MatrixType<-1, -1> W(DOF, 2 * DOF);
+            W << F * U.template triangularView<UnitUpper>(), G;
+            MatrixType<-1, 1> weights(2 * DOF);
+            weights << d, q;
+            thornton(W, weights);
+        }
+
+        /**
+         * Update the State Estimate with automatically differentiated Jacobian Matrices
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        void update(MeasurementModel measurementModel, const MatrixBase<Derived> &R, const Measurement &z,
+                    const Variables &...variables) {
+            static constexpr int MDOF = DOFOf<Measurement>;
+            //Derivative storage of the Jets for this step
+            ceres::JetArena::Scope arenaScope(jetArena);
+            //Bind the auxiliary variables to the measurement model
+            auto h = [&measurementModel, &variables...](const auto &state) {
+                return eval(measurementModel(state, variables ...));
+            };
+            //The jacobian matrix to be calculated from the measurement model
+            JacobianOf<Measurement> H(MDOF, DOF);
+            //The result of the measurement model
+            typename StateInfo<Measurement>::type hx;
+            //The result of the measurement model with a dual component vector added to the state
+            auto input = h(this->seededState());
+            //Calculate the Jacobian and the result of the measurement model
+            this->update_impl(hx, input, h, H);
+            //The measurement model has to be differentiable
+            assert(!H.hasNaN() && "Differentiation resulted in an indeterminate form");
+            //Decorrelate the measurement noise R=Ur*diag(r)*Ur^T, Ur^-1*(z-h(x)) has the covariance diag(r)
+            MatrixType<MDOF, MDOF> Ur;
+            MatrixType<MDOF, 1> r;
+            udFactor(R, Ur, r);
+            auto Hr = Ur.template triangularView<UnitUpper>().solve(H).eval();
+            auto delta = Ur.template triangularView<UnitUpper>().solve(Base::asVector(eval(z - hx))).eval();
+            //Process the rows as scalar measurements, all linearized at the prior State Estimate
+            MatrixType<DOF, 1> diff = MatrixType<DOF, 1>::Zero();
+            for (int i = 0; i < MDOF; ++i)
+                bierman(Hr.row(i), r(i), delta(i) - Hr.row(i).dot(diff), diff);
+            //Set the new State Estimate
+            move(diff);
+        }
+
+    private:
+        /**
+         * Sets U and d so that U*diag(d)*U^T = W*diag(weights)*W^T with Thornton's modified weighted Gram-Schmidt
+         * orthogonalization
+         * @param W The factor with DOF rows, orthogonalized in place
+         * @param weights The diagonal weights of the columns of W
+         */
+        void thornton(MatrixType<-1, -1> &W, const MatrixType<-1, 1> &weights) {
+            U.setIdentity();
+            for (int k = DOF - 1; k >= 0; --k) {
+                //The weighted row k
+                MatrixType<-1, 1> c = W.row(k).transpose().cwiseProduct(weights);
+                d(k) = W.row(k).dot(c);
+                //Directions without variance are not coupled to the others
+                if (d(k) <= 0) {
+                    d(k) = 0;
+                    continue;
+                }
+                for (int j = 0; j < k; ++j) {
+                    U(j, k) = W.row(j).dot(c) / d(k);
+                    W.row(j) -= U(j, k) * W.row(k);
+                }
+            }
+        }
+
+        /**
+         * Bierman's update of U and d with a scalar measurement
+         * @param h The row of the measurement Jacobian
+         * @param r The variance of the measurement
+         * @param innovation The innovation of the measurement at the current correction
+         * @param diff The correction of the State Estimate, the correction of this measurement is added
+         */
+        template<typename DerivedH>
+        void bierman(const MatrixBase<DerivedH> &h, ScalarType r, ScalarType innovation, MatrixType<DOF, 1> &diff) {
+            //f=U^T*h^T and v=diag(d)*f
+            MatrixType<DOF, 1> f = U.template triangularView<UnitUpper>().transpose() * h.transpose();
+            MatrixType<DOF, 1> v = d.cwiseProduct(f);
+            //The unnormalized Kalman Gain
+            MatrixType<DOF, 1> b = MatrixType<DOF, 1>::Zero();
+            //The innovation variance of the first j states
+            ScalarType alpha = r + f(0) * v(0);
+            assert(alpha > 0 && "The innovation variance has to be positive");
+            d(0) *= r / alpha;
+            b(0) = v(0);
+            for (int j = 1; j < DOF; ++j) {
+                ScalarType beta = alpha;
+                alpha += f(j) * v(j);
+                ScalarType lambda = -f(j) / beta;
+                d(j) *= beta / alpha;
+                for (int i = 0; i < j; ++i) {
+                    ScalarType Uij = U(i, j);
+                    U(i, j) = Uij + lambda * b(i);
+                    b(i) += v(j) * Uij;
+                }
+                b(j) = v(j);
+            }
+            diff += b * (innovation / alpha);
+        }
+
+        /**
+         * Adds an Offset to the Estimated State and moves the UD factors to the new Estimate
+         * @param diff The Difference to be added to the state
+         */
+        void move(const MatrixType<DOF, 1> &diff) {
+            //Add the Difference on the Estimated State
+            State newMu = mu + diff;
+            if constexpr (std::is_base_of<Manifold, State>::value || std::is_base_of<CompoundManifold, State>::value) {
+                //Calculate the Jacobian of the Boxplus Function
+                JacobianOf<State> D(DOF, DOF);
+                transformReferenceJacobian(mu, newMu, diff, D);
+                //D*P*D^T = (D*U)*diag(d)*(D*U)^T
+                MatrixType<-1, -1> W = D * U.template triangularView<UnitUpper>();
+                MatrixType<-1, 1> weights = d;
+                thornton(W, weights);
+            }
+            //Set the new Estimated Value
+            mu = newMu;
+        }
+    };
+
+    /**
+     * General Deduction Template for the UDADEKF based on StateRetriever.
+     */
+    template<typename DERIVED, typename COV_TYPE>
+    UDADEKF(const DERIVED &, const COV_TYPE &) -> UDADEKF<typename StateInfo<DERIVED>::type>;
+
 }
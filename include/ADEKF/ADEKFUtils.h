@@ -2,7 +2,14 @@
 
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
+#include <Eigen/Cholesky>
+#include <Eigen/QR>
 #include "ceres/jet.h"
+#include "ceres/sparse_jet.h"
+#include "ceres/reverse_jet.h"
+
+#include <functional>
+
 namespace adekf
 {
 
@@ -23,27 +30,205 @@ namespace adekf
 
     /**
          * Generates a Vector of dual Components
+         *
+         * The vector is created once per Size by the thread safe initialization of a local static and only read
+         * afterwards, so filters in different threads can share it.
          * @tparam Size The Size of the Vector and the dual components
+         * @tparam ScalarType The scalar type of the Jets, float halves the memory traffic of the dual components
          * @return A dual component vector, to be added to a state
          */
+    template <unsigned Size, typename ScalarType = double>
+    const Eigen::Matrix<ceres::Jet<ScalarType, Size>, Size, 1> &getDerivator()
+    {
+        //The resulting dual component vector, only set on first call
+        static const Eigen::Matrix<ceres::Jet<ScalarType, Size>, Size, 1> result = [] {
+            //The vector outlives every model evaluation, so it must not be stored in a JetArena
+            ceres::JetArena::Suspend heapOnly;
+            Eigen::Matrix<ceres::Jet<ScalarType, Size>, Size, 1> seeds;
+            seeds.setZero();
+            //Set the first coefficient in the first row to 1, the second in the second and so on.
+            for (unsigned i = 0; i < Size; ++i)
+                seeds[i].v[i] = 1; // = ceres::Jet<ScalarType, Size>(0, i);
+            return seeds;
+        }();
+        return result;
+    }
+
+    /**
+     * Generates a Vector of sparse dual Components
+     *
+     * Each entry only stores its own derivative, so models which read few entries of the state produce results with
+     * few non zero derivatives. Like getDerivator, it is created once and shared between threads.
+     * @tparam Size The Size of the Vector and the dual components
+     * @return A sparse dual component vector, to be added to a state
+     */
     template <unsigned Size>
-    const Eigen::Matrix<ceres::Jet<double, Size>, Size, 1> &getDerivator()
-    {
-        //The resulting dual component vector
-        static Eigen::Matrix<ceres::Jet<double, Size>, Size, 1> result;
-        //only set on first call
-        static bool first_call = true;
-        //Set the first coefficient in the first row to 1, the second in the second and so on.
-        if (first_call)
-        {
-            result.setZero();
+    const Eigen::Matrix<ceres::SparseJet<double, Size>, Size, 1> &getSparseDerivator()
+    {
+        //The resulting dual component vector, only set on first call
+        static const Eigen::Matrix<ceres::SparseJet<double, Size>, Size, 1> result = [] {
+            //The vector outlives every model evaluation, so it must not be stored in a JetArena
+            ceres::JetArena::Suspend heapOnly;
+            Eigen::Matrix<ceres::SparseJet<double, Size>, Size, 1> seeds;
             for (unsigned i = 0; i < Size; ++i)
-                result[i].v[i] = 1; // = ceres::Jet<ScalarType, Size>(0, i);
-            first_call = false;
-        }
+                seeds[i] = ceres::SparseJet<double, Size>(0., i);
+            return seeds;
+        }();
         return result;
     }
 
+    /**
+     * Generates a Vector of recording scalars for reverse mode differentiation
+     *
+     * The i-th entry refers to the i-th input of a ReverseTape, so the tape has to be reset with Size inputs before use.
+     * The entries only store their index, so the tape of each filter can use the shared vector.
+     * @tparam Size The Size of the Vector
+     * @return A vector of ReverseJets, to be added to a state
+     */
+    template <unsigned Size>
+    const Eigen::Matrix<ceres::ReverseJet<double, Size>, Size, 1> &getReverseDerivator()
+    {
+        //The resulting vector, only set on first call
+        static const Eigen::Matrix<ceres::ReverseJet<double, Size>, Size, 1> result = [] {
+            Eigen::Matrix<ceres::ReverseJet<double, Size>, Size, 1> seeds;
+            for (unsigned i = 0; i < Size; ++i)
+                seeds[i] = ceres::ReverseJet<double, Size>(0., i);
+            return seeds;
+        }();
+        return result;
+    }
+
+    /**
+     * Writes the dual component of a Jet into a row of a Jacobian
+     *
+     * A Jet may have more dual components than the row, e.g. padded to fill a SIMD register. The surplus components are
+     * dropped.
+     * @param row The row of the Jacobian
+     * @param jet The Jet to read the derivatives from
+     */
+    template <typename Derived, typename ScalarType, int N>
+    void assignDerivative(const Eigen::MatrixBase<Derived> &row, const ceres::Jet<ScalarType, N> &jet)
+    {
+        constexpr int Cols = Derived::ColsAtCompileTime;
+        //Eigen's recommended way to write into temporary blocks
+        if constexpr (Cols != Eigen::Dynamic && Cols < N)
+            const_cast<Eigen::MatrixBase<Derived> &>(row) =
+                    jet.v.transpose().template head<Cols>().template cast<typename Derived::Scalar>();
+        else
+            const_cast<Eigen::MatrixBase<Derived> &>(row) = jet.v.transpose().template cast<typename Derived::Scalar>();
+    }
+
+    /**
+     * Scatters the non zero derivatives of a SparseJet into a row of a Jacobian
+     * @param row The row of the Jacobian
+     * @param jet The SparseJet to read the derivatives from
+     */
+    template <typename Derived, typename ScalarType, int N>
+    void assignDerivative(const Eigen::MatrixBase<Derived> &row, const ceres::SparseJet<ScalarType, N> &jet)
+    {
+        jet.v.toDense(row);
+    }
+
+    /**
+     * Reads the real part of a scalar which is not a dual number
+     * @param value The scalar
+     * @return The scalar itself
+     */
+    template <typename ScalarType, typename = std::enable_if_t<std::is_arithmetic_v<ScalarType>>>
+    ScalarType valueOf(ScalarType value)
+    {
+        return value;
+    }
+
+    /**
+     * Reads the real part of a Jet, a SparseJet or a ReverseJet
+     * @param jet The dual number
+     * @return The real part, which is the result of the same calculation without derivatives
+     */
+    template <typename JetType>
+    auto valueOf(const JetType &jet) -> decltype(jet.a)
+    {
+        return jet.a;
+    }
+
+    /**
+     * The type of the real part of a dual number or of a Manifold or Matrix of dual numbers
+     */
+    template <typename T>
+    using ValueOf = decltype(valueOf(std::declval<const T &>()));
+
+    /**
+     * Reads the real part of each entry of a Matrix of dual numbers
+     * @param matrix The Matrix
+     * @return A Matrix of the real parts
+     */
+    template <typename Derived>
+    auto valueOf(const Eigen::MatrixBase<Derived> &matrix)
+    {
+        return matrix.unaryExpr([](const auto &entry) { return valueOf(entry); }).eval();
+    }
+
+    /**
+     * Reads the real parts of a CompoundManifold of dual numbers
+     * @param state The CompoundManifold
+     * @return The CompoundManifold of the real parts
+     */
+    template <template <typename> class Compound, typename T,
+              typename = std::enable_if_t<std::is_base_of_v<CompoundManifold, Compound<T>>>>
+    Compound<ValueOf<T>> valueOf(const Compound<T> &state)
+    {
+        Compound<ValueOf<T>> value;
+        value.vector_part = valueOf(state.vector_part);
+        auto assignValue = [](auto &member, auto &valueMember) {
+            valueMember = valueOf(member);
+        };
+        state.forEachManifoldWithOther(assignValue, value);
+        return value;
+    }
+
+    /**
+     * Converts a scalar which is not a dual number to another scalar type
+     * @tparam NewScalar The scalar type to convert to
+     * @param value The scalar
+     * @return The converted scalar
+     */
+    template <typename NewScalar, typename ScalarType, typename = std::enable_if_t<std::is_arithmetic_v<ScalarType>>>
+    NewScalar castTo(ScalarType value)
+    {
+        return NewScalar(value);
+    }
+
+    /**
+     * Converts each entry of a Matrix to another scalar type
+     * @tparam NewScalar The scalar type to convert to
+     * @param matrix The Matrix
+     * @return The converted Matrix
+     */
+    template <typename NewScalar, typename Derived>
+    auto castTo(const Eigen::MatrixBase<Derived> &matrix)
+    {
+        return matrix.template cast<NewScalar>().eval();
+    }
+
+    /**
+     * Converts a CompoundManifold to another scalar type
+     * @tparam NewScalar The scalar type to convert to
+     * @param state The CompoundManifold
+     * @return The CompoundManifold with the new scalar type
+     */
+    template <typename NewScalar, template <typename> class Compound, typename T,
+              typename = std::enable_if_t<std::is_base_of_v<CompoundManifold, Compound<T>>>>
+    Compound<NewScalar> castTo(const Compound<T> &state)
+    {
+        Compound<NewScalar> converted;
+        converted.vector_part = castTo<NewScalar>(state.vector_part);
+        auto assignConverted = [](auto &member, auto &convertedMember) {
+            convertedMember = castTo<NewScalar>(member);
+        };
+        state.forEachManifoldWithOther(assignConverted, converted);
+        return converted;
+    }
+
     /**
      * Retrieves Scalar Type and DOF from a given Manifold Class
      * @tparam T The given class
@@ -93,8 +278,8 @@ namespace adekf
      * Specialization of StateInfo for float types
      */
 
-    template <bool s>
-    struct StateInfo<float, s>
+    template <>
+    struct StateInfo<float, false>
     {
         using ScalarType = float;
         static constexpr int DOF = 1;
@@ -149,6 +334,58 @@ namespace adekf
     template <int N, int M>
     static constexpr bool dynamicMatrix = N *M > USE_EIGEN_DYNAMIC_THRESHHOLD;
 
+    /**
+     * Checks whether a type can be iterated with std::begin, e.g. a std::vector
+     * @tparam T The type to check
+     */
+    template <typename T, typename = void>
+    constexpr bool isRange = false;
+
+    template <typename T>
+    constexpr bool isRange<T, std::void_t<decltype(std::begin(std::declval<const T &>()))>> = true;
+
+    /**
+     * Checks whether a type is a std::function, which hides the identity of the wrapped model
+     * @tparam T The type to check
+     */
+    template <typename T>
+    constexpr bool isStdFunction = false;
+
+    template <typename Signature>
+    constexpr bool isStdFunction<std::function<Signature>> = true;
+
+    /**
+     * Compares two arguments of a model exactly, e.g. the control vectors of a cached linear model
+     * @param a The first argument
+     * @param b The second argument
+     * @return true if a and b are equal. Matrices of different sizes are unequal, Manifolds are compared by boxminus
+     */
+    template <typename T>
+    bool equalArgument(const T &a, const T &b) {
+        if constexpr (std::is_base_of<Manifold, T>::value)
+            return (a - b).isZero(0);
+        else if constexpr (std::is_base_of<Eigen::EigenBase<T>, T>::value)
+            return a.rows() == b.rows() && a.cols() == b.cols() && a == b;
+        else
+            return a == b;
+    }
+
+#ifndef ADEKF_REVERSE_MODE_RATIO
+/**
+ * update() differentiates in reverse mode if the DOF of the state is at least ADEKF_REVERSE_MODE_RATIO times the DOF of
+ * the measurement. Define it as 0 to always use forward mode.
+ */
+#define ADEKF_REVERSE_MODE_RATIO 8
+#endif
+
+#ifndef ADEKF_JET_CHUNK_SIZE
+/**
+ * Number of Jacobian columns which are differentiated at once by predictChunked and updateChunked.
+ * Chunk Jets stay fixed size as long as ADEKF_JET_CHUNK_SIZE^2 <= USE_EIGEN_DYNAMIC_THRESHHOLD.
+ */
+#define ADEKF_JET_CHUNK_SIZE 4
+#endif
+
     /**
          * A Matrix type (It is the Eigen::Matrix)
          * @tparam N Number of Rows
@@ -162,7 +399,7 @@ namespace adekf
          * @tparam M Number of Columns
          */
     template <typename ScalarType, int N, int M>
-    using AutoMatrixType = typename std::conditional<dynamicMatrix<N, M>, Eigen::Matrix<double, -1, -1>, Eigen::Matrix<double, N, N>>::type;
+    using AutoMatrixType = typename std::conditional<dynamicMatrix<N, M>, Eigen::Matrix<double, -1, -1>, Eigen::Matrix<double, N, M>>::type;
 
     /**
          * A Square Matrix with the Scalar Type of the State
@@ -359,6 +596,145 @@ namespace adekf
             assert(isPositiveDefinite(matrix));
         }
     }
+
+    /**
+ * Copies the lower triangle of a matrix into its upper triangle
+ *
+ * Symmetric results like covariances only need their lower triangle to be calculated, the copy keeps them exactly symmetric.
+ * @tparam Derived type of the Matrix
+ * @param matrix the square matrix, inplace operation
+ */
+    template <class Derived>
+    void symmetrizeFromLower(Eigen::MatrixBase<Derived> &matrix)
+    {
+        matrix.template triangularView<Eigen::StrictlyUpper>() = matrix.transpose();
+    }
+
+    /**
+ * Calculates a lower triangular matrix L with L*L^T = A*A^T from the QR decomposition of A^T
+ *
+ * The product A*A^T is never formed, so L stays a valid Cholesky factor even if A*A^T is badly conditioned.
+ * @tparam Derived type of the Matrix
+ * @param A matrix with at least as many columns as rows
+ * @return the lower triangular factor with a non negative diagonal
+ */
+    template <class Derived>
+    Eigen::Matrix<typename Derived::Scalar, -1, -1> triangularFactor(const Eigen::MatrixBase<Derived> &A)
+    {
+        assert(A.cols() >= A.rows() && "The factor has to have at least as many columns as rows");
+        Eigen::HouseholderQR<Eigen::Matrix<typename Derived::Scalar, -1, -1>> qr(A.transpose());
+        Eigen::Matrix<typename Derived::Scalar, -1, -1> L = qr.matrixQR().topRows(A.rows()).template triangularView<Eigen::Upper>().transpose();
+        //The signs of the columns are arbitrary, L*L^T does not change by flipping them
+        for (int i = 0; i < L.cols(); i++)
+        {
+            if (L(i, i) < 0)
+                L.col(i) = -L.col(i);
+        }
+        return L;
+    }
+
+    /**
+ * Calculates a square root L with L*L^T = matrix of a positive semi definite matrix
+ *
+ * Uses a ldlt decomposition, so zero variances are allowed
+ * @tparam Derived type of the Matrix
+ * @param matrix the positive semi definite matrix
+ * @return the square root
+ */
+    template <class Derived>
+    Eigen::Matrix<typename Derived::Scalar, -1, -1> squareRoot(const Eigen::MatrixBase<Derived> &matrix)
+    {
+        Eigen::LDLT<Eigen::Matrix<typename Derived::Scalar, -1, -1>> _ldlt(matrix);
+        assert(_ldlt.info() == Eigen::Success && "The matrix has to be positive semi definite");
+        Eigen::Matrix<typename Derived::Scalar, -1, -1> L = _ldlt.matrixL();
+        L = _ldlt.transpositionsP().transpose() * (L * _ldlt.vectorD().cwiseMax(0).cwiseSqrt().asDiagonal());
+        return L;
+    }
+
+    /**
+ * Calculates the UD decomposition matrix = U*diag(d)*U^T of a positive semi definite matrix
+ *
+ * U is unit upper triangular. Needs neither square roots nor divisions by zero variances.
+ * @tparam Derived type of the Matrix
+ * @tparam DerivedU type of U
+ * @tparam DerivedD type of d
+ * @param matrix the positive semi definite matrix
+ * @param U the resulting unit upper triangular matrix
+ * @param d the resulting diagonal
+ */
+    template <class Derived, class DerivedU, class DerivedD>
+    void udFactor(const Eigen::MatrixBase<Derived> &matrix, Eigen::MatrixBase<DerivedU> &U, Eigen::MatrixBase<DerivedD> &d)
+    {
+        using Scalar = typename Derived::Scalar;
+        const Eigen::Index n = matrix.rows();
+        U.setIdentity();
+        for (Eigen::Index j = n - 1; j >= 0; j--)
+        {
+            const Eigen::Index rest = n - j - 1;
+            d(j) = matrix(j, j) - (d.tail(rest).array() * U.block(j, j + 1, 1, rest).transpose().array().square()).sum();
+            assert(d(j) > -Eigen::NumTraits<Scalar>::dummy_precision() && "The matrix has to be positive semi definite");
+            for (Eigen::Index i = 0; i < j; i++)
+            {
+                U(i, j) = d(j) > 0 ? (matrix(i, j) - (d.tail(rest).array() * U.block(i, j + 1, 1, rest).transpose().array() * U.block(j, j + 1, 1, rest).transpose().array()).sum()) / d(j) : Scalar(0);
+            }
+            if (d(j) < 0)
+                d(j) = 0;
+        }
+    }
+
+    /**
+ * Downdates a lower triangular Cholesky factor L, so that L*L^T becomes L*L^T - x*x^T
+ *
+ * Needs O(n^2) operations instead of O(n^3) for a new decomposition
+ * @tparam DerivedL type of the Cholesky factor
+ * @tparam DerivedX type of the downdate vector
+ * @param L the Cholesky factor, inplace operation
+ * @param x the downdate vector
+ * @return false if the downdated matrix is not positive definite, e.g. by rounding errors. L is invalid then.
+ */
+    template <class DerivedL, class DerivedX>
+    bool choleskyDowndate(Eigen::MatrixBase<DerivedL> &L, const Eigen::MatrixBase<DerivedX> &x)
+    {
+        using Scalar = typename DerivedL::Scalar;
+        auto v = x.eval();
+        const Eigen::Index n = L.rows();
+        for (Eigen::Index k = 0; k < n; k++)
+        {
+            Scalar squared = L(k, k) * L(k, k) - v(k) * v(k);
+            if (!(squared > 0))
+                return false;
+            Scalar r = std::sqrt(squared);
+            Scalar c = r / L(k, k);
+            Scalar s = v(k) / L(k, k);
+            L(k, k) = r;
+            const Eigen::Index rest = n - k - 1;
+            if (rest > 0)
+            {
+                L.col(k).tail(rest) = (L.col(k).tail(rest) - s * v.tail(rest)) / c;
+                v.tail(rest) = c * v.tail(rest) - s * L.col(k).tail(rest);
+            }
+        }
+        return true;
+    }
+    /**
+ * @brief Extracts a Jacobian from the given vector with jets into an existing matrix.
+ *
+ * @tparam ScalarType The Scalartype of the Jet
+ * @tparam _LDOF The number of Rows
+ * @tparam _RDOF The number of Cols
+ * @tparam Derived The type of the Jacobian
+ * @param result The vector to extract the Jacobi from. Has to be the result of automatic Differentiation with jets
+ * @param jacobi The extracted Jacobian, has to be of size _LDOF x _RDOF
+ */
+    template <typename ScalarType, int _LDOF, int _RDOF, typename Derived>
+    void extractJacobi(const Eigen::Matrix<ceres::Jet<ScalarType, _RDOF>, _LDOF, 1> &result, const Eigen::MatrixBase<Derived> &jacobi)
+    {
+        for (size_t j = 0; j < _LDOF; ++j)
+        {
+            const_cast<Eigen::MatrixBase<Derived> &>(jacobi).row(j) = result(j).v;
+        }
+    }
+
     /**
  * @brief Extracts a Jacobian from the given vector with jets.
  * 
@@ -372,10 +748,7 @@ namespace adekf
     AutoMatrixType<ScalarType, _LDOF, _RDOF> extractJacobi(const Eigen::Matrix<ceres::Jet<ScalarType, _RDOF>, _LDOF, 1> &result)
     {
         AutoMatrixType<ScalarType, _LDOF, _RDOF> jacobi(_LDOF, _RDOF);
-        for (size_t j = 0; j < _LDOF; ++j)
-        {
-            jacobi.row(j) = result(j).v;
-        }
+        extractJacobi(result, jacobi);
         return jacobi;
     }
 
@@ -391,15 +764,34 @@ namespace adekf
      */
     template <typename ManifoldType, int DOF = DOFOf<ManifoldType>>
     inline AutoMatrixType<ScalarOf<ManifoldType>, DOF, DOF> transformReferenceJacobian(const ManifoldType &ref1, const ManifoldType &ref2, const decltype(ref2 - ref1) &Er1)
+    {
+        AutoMatrixType<ScalarOf<ManifoldType>, DOF, DOF> D(DOF, DOF);
+        transformReferenceJacobian(ref1, ref2, Er1, D);
+        return D;
+    }
+
+    /**
+     * @brief Calculates the transformation Jacobian that transform from reference r1 to reference r2 into an existing matrix
+     *
+     * @tparam Manifold The type of the manifold
+     * @tparam Derived The type of the Jacobian
+     * @tparam DOF The degree of freedom of the manifold
+     * @param ref1 The base reference
+     * @param ref2 The target reference
+     * @param Er1  The expected value of the Gaussian in the base reference
+     * @param D The jacobian that transforms the covariance from the base to target reference, has to be of size DOF x DOF
+     */
+    template <typename ManifoldType, typename Derived, int DOF = DOFOf<ManifoldType>>
+    inline void transformReferenceJacobian(const ManifoldType &ref1, const ManifoldType &ref2, const decltype(ref2 - ref1) &Er1, Eigen::MatrixBase<Derived> &D)
     {
         if constexpr (!std::is_base_of<CompoundManifold, ManifoldType>::value)
         {
-            return extractJacobi(ref1 + (Er1 + getDerivator<DOF>()) - ref2);
+            extractJacobi(ref1 + (Er1 + getDerivator<DOF, ScalarOf<ManifoldType>>()) - ref2, D);
         }
         else
         {
             //Definition of the Jacobian of the Boxplus Function
-            AutoMatrixType<ScalarOf<ManifoldType>, DOF, DOF> D = D.Identity(DOF, DOF);
+            D.setIdentity();
             //Counter for the current dof at iterating
             int dof = 0;
             //calculate the part of the Jacobian which belongs to the Manifold
@@ -412,10 +804,57 @@ namespace adekf
             };
             //apply on each manifold, for vectors the Jacobian is the Identity
             ref1.forEachManifoldWithOther(calcManifoldJacobian,ref2);
-
-             return D;
         }
     }
+    /**
+     * @brief Transforms a covariance from reference r1 to reference r2, P=D*P*D^T with the transformation Jacobian D
+     *
+     * For CompoundManifolds D is the identity on the vector part and block diagonal on the manifold members, so only
+     * the rows and columns of the manifold members are transformed. This costs O(DOF) per manifold member instead of
+     * O(DOF^3) for the dense products. The result is exactly symmetric.
+     * @tparam ManifoldType The type of the manifold
+     * @tparam Derived The type of the covariance
+     * @param ref1 The base reference
+     * @param ref2 The target reference
+     * @param Er1  The expected value of the Gaussian in the base reference
+     * @param P The symmetric covariance in the base reference, transformed inplace
+     */
+    template <typename ManifoldType, typename Derived>
+    inline void transformReferenceCovariance(const ManifoldType &ref1, const ManifoldType &ref2, const decltype(ref2 - ref1) &Er1, Eigen::MatrixBase<Derived> &P)
+    {
+        if constexpr (!std::is_base_of<CompoundManifold, ManifoldType>::value)
+        {
+            auto D = transformReferenceJacobian(ref1, ref2, Er1);
+            P = (D * P * D.transpose()).eval();
+            symmetrizeFromLower(P);
+        }
+        else
+        {
+            //Counter for the current dof at iterating
+            int dof = 0;
+            //Transform the rows and columns of each Manifold with its block of the Jacobian
+            auto transformManifold = [&](auto &manifold, auto &other_manifold) {
+                int constexpr curDOF = DOFOf<decltype(manifold)>;
+                auto cur_Er1 = Er1.template segment<curDOF>(dof);
+                auto D = transformReferenceJacobian(manifold, other_manifold, cur_Er1);
+                //The rows of the manifold, column by column to stay on the stack
+                for (Eigen::Index j = 0; j < P.cols(); ++j)
+                    P.template block<curDOF, 1>(dof, j) = (D * P.template block<curDOF, 1>(dof, j)).eval();
+                //The diagonal block is also transformed from the right
+                decltype(D) block = P.template block<curDOF, curDOF>(dof, dof) * D.transpose();
+                symmetrizeFromLower(block);
+                P.template block<curDOF, curDOF>(dof, dof) = block;
+                //The columns of the manifold are the transposed rows
+                Eigen::Index rest = P.rows() - dof - curDOF;
+                P.block(0, dof, dof, curDOF) = P.block(dof, 0, curDOF, dof).transpose();
+                P.block(dof + curDOF, dof, rest, curDOF) = P.block(dof, dof + curDOF, curDOF, rest).transpose();
+                dof += curDOF;
+            };
+            //apply on each manifold, for vectors the Jacobian is the Identity
+            ref1.forEachManifoldWithOther(transformManifold, ref2);
+        }
+    }
+
     /**
      * @brief Calculates the transformation Jacobian that transform from reference r1 to reference r2
      * 
@@ -432,7 +871,7 @@ namespace adekf
     {
          if constexpr (!std::is_base_of<CompoundManifold, ManifoldType>::value)
         {
-            return extractJacobi(ref1 + getDerivator<DOF>() - ref2);
+            return extractJacobi(ref1 + getDerivator<DOF, ScalarOf<ManifoldType>>() - ref2);
         }
         else
         {
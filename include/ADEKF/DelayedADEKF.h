@@ -0,0 +1,346 @@
+#pragma once
+
+#include "ADEKF.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace adekf {
+
+    /**
+     * An ADEKF which accepts measurements with a time stamp in the past
+     *
+     * Each predict and update is stored with its time stamp, the state estimate and covariance before the step and the
+     * step itself (the model with copies of its noise, controls, measurement and auxiliary variables). A late
+     * measurement is inserted after the last step which is not later than its time stamp: the filter is reset to the
+     * stored estimate at that point, the measurement is applied and all later steps are repeated. Nonlinear models
+     * are linearized again at the corrected estimates, so the result equals the one with measurements in order.
+     *
+     * The history is bounded by a time window and a maximum number of steps. Measurements which are older than the
+     * history are dropped. The estimates of all steps are allocated in the constructor and reused, the step and its
+     * arguments are stored in place in a buffer of PayloadSize bytes per step. The process noise of the stored
+     * predictions is kept in a separate pool which only grows with the number of stored predictions.
+     * @tparam State The State to be used for estimation
+     * @tparam PayloadSize The size of the buffer for the model and the copies of its arguments of a step
+     */
+    template<typename State, std::size_t PayloadSize = 512>
+    class DelayedADEKF : private ADEKF<State> {
+        using Base = ADEKF<State>;
+
+    public:
+        /**
+         * The Covariance type of the State
+         */
+        using Covariance = typename Base::Covariance;
+
+        using Base::mu;
+        using Base::sigma;
+        using Base::jetArena;
+        using Base::workspace;
+
+    private:
+        /**
+         * A step of the filter with the estimate before it
+         */
+        struct Entry {
+            double time = 0.;
+            State mu;
+            Covariance sigma;
+            /**
+             * The index of the process noise of a prediction in the pool, -1 for other steps
+             */
+            int noise = -1;
+            /**
+             * The step with copies of its arguments
+             */
+            alignas(std::max(alignof(std::max_align_t), std::size_t(EIGEN_MAX_STATIC_ALIGN_BYTES)))
+            unsigned char payload[PayloadSize];
+            /**
+             * Applies the step in the payload to the filter
+             */
+            void (*step)(Entry &, Base &, const Covariance *) = nullptr;
+            /**
+             * Destroys the step in the payload
+             */
+            void (*destroy)(Entry &) = nullptr;
+
+            Entry() = default;
+
+            Entry(const Entry &) = delete;
+
+            Entry &operator=(const Entry &) = delete;
+
+            ~Entry() {
+                clear();
+            }
+
+            /**
+             * Stores a step in the payload
+             * @tparam Step Type of the Step, a functor void(Base &, const Covariance *) called with the process noise
+             * @param newStep The step
+             */
+            template<typename Step>
+            void store(Step &&newStep) {
+                using StepType = std::decay_t<Step>;
+                static_assert(sizeof(StepType) <= PayloadSize,
+                              "The step and its arguments do not fit into the payload, increase PayloadSize");
+                static_assert(alignof(StepType) <= alignof(Entry), "The step is overaligned for the payload");
+                clear();
+                new(payload) StepType(std::forward<Step>(newStep));
+                step = [](Entry &entry, Base &filter, const Covariance *noise) {
+                    (*std::launder(reinterpret_cast<StepType *>(entry.payload)))(filter, noise);
+                };
+                destroy = [](Entry &entry) {
+                    std::launder(reinterpret_cast<StepType *>(entry.payload))->~StepType();
+                };
+            }
+
+            /**
+             * Destroys the stored step
+             */
+            void clear() {
+                if (destroy)
+                    destroy(*this);
+                step = nullptr;
+                destroy = nullptr;
+            }
+        };
+
+        /**
+         * The steps, one more than the capacity so a step can be inserted before the oldest one is forgotten
+         */
+        std::vector<Entry> entries;
+
+        /**
+         * A ring of the indices of all entries, the first count from head are the stored steps in the order of their
+         * time stamps and the others are unused
+         */
+        std::vector<size_t> order;
+
+        /**
+         * The process noises of the stored predictions, kept apart from the entries since a dynamic sized copy in the
+         * payload would allocate
+         */
+        std::vector<Covariance> noises;
+
+        /**
+         * The indices of the unused process noises
+         */
+        std::vector<int> unusedNoises;
+
+        /**
+         * The position of the oldest step in order
+         */
+        size_t head = 0;
+
+        /**
+         * The number of stored steps
+         */
+        size_t count = 0;
+
+        /**
+         * Steps older than this before the latest step are forgotten
+         */
+        double window;
+
+        /**
+         * The maximum number of stored steps
+         */
+        size_t capacity;
+
+        /**
+         * The time stamp of the newest forgotten step, measurements before it can not be applied anymore
+         */
+        double oldestTime;
+
+        /**
+         * @param k The position in the history, 0 is the oldest step
+         * @return The step at the position
+         */
+        Entry &at(size_t k) {
+            return entries[order[(head + k) % order.size()]];
+        }
+
+        /**
+         * @param k The position in the history, 0 is the oldest step
+         * @return The step at the position
+         */
+        const Entry &at(size_t k) const {
+            return entries[order[(head + k) % order.size()]];
+        }
+
+        /**
+         * Forgets the steps which are outside of the window or exceed the capacity
+         */
+        void forget() {
+            while (count > 0 && (count > capacity || at(0).time < time() - window)) {
+                oldestTime = at(0).time;
+                if (at(0).noise >= 0)
+                    unusedNoises.push_back(at(0).noise);
+                at(0).noise = -1;
+                at(0).clear();
+                head = (head + 1) % order.size();
+                --count;
+            }
+        }
+
+        /**
+         * Inserts a step at its time stamp, applies it and repeats the later steps
+         * @tparam Step Type of the Step, a functor void(Base &, const Covariance *) called with the process noise
+         * @param time The time stamp of the step
+         * @param step The step with copies of its arguments
+         * @param noise The process noise stored with the step, nullptr if it has none
+         * @return false if the time stamp is older than the history, then the step is dropped
+         */
+        template<typename Step>
+        bool insert(double time, Step &&step, const Covariance *noise = nullptr) {
+            if (time < oldestTime)
+                return false;
+            //The first step after the time stamp, late steps are usually close to the latest one
+            size_t position = count;
+            while (position > 0 && at(position - 1).time > time)
+                --position;
+            //Reset to the estimate before it
+            if (position < count) {
+                mu = at(position).mu;
+                sigma = at(position).sigma;
+            }
+            //Move the first unused index to the position
+            size_t unused = order[(head + count) % order.size()];
+            for (size_t k = count; k > position; --k)
+                order[(head + k) % order.size()] = order[(head + k - 1) % order.size()];
+            order[(head + position) % order.size()] = unused;
+            ++count;
+            Entry &inserted = at(position);
+            inserted.time = time;
+            if (noise) {
+                //Reuse the process noise of a forgotten prediction if there is one
+                if (unusedNoises.empty()) {
+                    inserted.noise = int(noises.size());
+                    noises.push_back(*noise);
+                } else {
+                    inserted.noise = unusedNoises.back();
+                    unusedNoises.pop_back();
+                    noises[inserted.noise] = *noise;
+                }
+            }
+            inserted.store(std::forward<Step>(step));
+            //Apply the step and repeat the later steps, store their new prior estimates
+            for (size_t k = position; k < count; ++k) {
+                Entry &entry = at(k);
+                entry.mu = mu;
+                entry.sigma = sigma;
+                entry.step(entry, *this, entry.noise >= 0 ? &noises[entry.noise] : nullptr);
+            }
+            forget();
+            return true;
+        }
+
+    public:
+        /**
+         * Constructor of the DelayedADEKF
+         *
+         * Allocates the estimates of the whole history, i.e. a state and a covariance per step of the capacity. Choose
+         * the capacity from the window and the rate of the steps, e.g. window*(predictionRate+measurementRate).
+         * @param _mu Initial Expected Value of the State
+         * @param _sigma Initial Covariance of the State
+         * @param _window The time span of the history, a measurement may be delayed by up to this
+         * @param _capacity The maximum number of stored steps
+         * @param startTime The time stamp of the initial estimate
+         */
+        DelayedADEKF(const State &_mu, const Covariance &_sigma, double _window, size_t _capacity,
+                     double startTime = 0.) : Base(_mu, _sigma), entries(_capacity + 1), order(_capacity + 1),
+                                              window(_window), capacity(_capacity), oldestTime(startTime) {
+            std::iota(order.begin(), order.end(), size_t(0));
+            noises.reserve(_capacity + 1);
+            unusedNoises.reserve(_capacity + 1);
+            for (Entry &entry: entries) {
+                entry.mu = _mu;
+                entry.sigma = _sigma;
+            }
+        }
+
+        /**
+         * @return The time stamp of the latest step
+         */
+        double time() const {
+            return count == 0 ? oldestTime : at(count - 1).time;
+        }
+
+        /**
+         * @return The number of stored steps
+         */
+        size_t historySize() const {
+            return count;
+        }
+
+        /**
+         * Applies and stores an arbitrary step, e.g. a call of predictSparse or updateGated
+         *
+         * If the time stamp is before the latest step, the step is inserted at its time and the later steps are
+         * repeated. The step is called again for this, so it must store copies of its arguments.
+         * @tparam Step Type of the Step
+         * @param time The time stamp of the step
+         * @param step A functor void(ADEKF<State> &) which applies the step to the filter
+         * @return false if the time stamp is older than the history, then the step is dropped
+         */
+        template<typename Step>
+        bool apply(double time, Step step) {
+            return insert(time, [step = std::move(step)](Base &filter, const Covariance *) mutable {
+                step(filter);
+            });
+        }
+
+        /**
+         * Predict the State Estimate with automatically differentiated Jacobian Matrices
+         * @tparam DynamicModel Type of the Dynamic Model Functor
+         * @tparam Controls Types of the Control Vectors
+         * @param time The time stamp after the prediction
+         * @param dynamicModel The Dynamic Model f(x,u)
+         * @param Q Additive Process Noise Covariance
+         * @param u Control Vectors
+         * @return false if the time stamp is older than the history
+         */
+        template<typename DynamicModel, typename... Controls>
+        bool predict(double time, DynamicModel dynamicModel, const Covariance &Q, const Controls &...u) {
+            return insert(time, [dynamicModel, u...](Base &filter, const Covariance *Q) {
+                filter.predict(dynamicModel, *Q, u...);
+            }, &Q);
+        }
+
+        /**
+         * Update the State Estimate with a Measurement from the past
+         *
+         * The measurement is applied after the last stored step which is not later than its time stamp, i.e. at the
+         * estimate of that step. It is not predicted to the exact time of the measurement, so the time stamps of the
+         * predictions have to be dense enough for the delay to be negligible.
+         * @tparam Measurement Type of the Measurement
+         * @tparam MeasurementModel Type of the Measurement Model Functor
+         * @tparam Variables Types of Auxiliary Variables for the Measurement Model
+         * @param time The time stamp of the Measurement
+         * @param measurementModel The Measurement Model h(x,variables)
+         * @param R Additive Measurement Noise Covariance, copied into the history. Only dynamic sized R allocate
+         * @param z Measurement
+         * @param variables Auxiliary Variables for the Measurement Model
+         * @return false if the time stamp is older than the history, then the measurement is dropped
+         */
+        template<typename Measurement, typename MeasurementModel, typename Derived, typename... Variables>
+        bool update(double time, MeasurementModel measurementModel, const MatrixBase<Derived> &R, const Measurement &z,
+                    const Variables &...variables) {
+            return insert(time, [measurementModel, R = R.eval(), z, variables...](Base &filter, const Covariance *) {
+                filter.update(measurementModel, R, z, variables...);
+            });
+        }
+    };
+
+    template<typename DERIVED, typename COV_TYPE>
+    DelayedADEKF(const DERIVED &, const COV_TYPE &, double, size_t) -> DelayedADEKF<typename StateInfo<DERIVED>::type>;
+
+    template<typename DERIVED, typename COV_TYPE>
+    DelayedADEKF(const DERIVED &, const COV_TYPE &, double, size_t,
+                 double) -> DelayedADEKF<typename StateInfo<DERIVED>::type>;
+}
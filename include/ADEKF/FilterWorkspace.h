@@ -0,0 +1,174 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+
+#include <map>
+#include <type_traits>
+
+namespace adekf {
+
+    /**
+     * Storage for the dynamic sized temporaries of predict and update.
+     *
+     * If the covariance of a state is a dynamic sized matrix, every step needs several temporaries of the same size
+     * (Jacobians, the boxplus Jacobian, the corrected covariance, ...) and of the size of the measurement (the innovation
+     * covariance, its factorization and the Kalman gain). By default they are freed at the end of each step. An enabled
+     * workspace keeps them, so after a warm up with every measurement size predict and update do not touch the heap.
+     * Fixed size temporaries always stay on the stack.
+     * @tparam ScalarType The scalar type of the filter
+     */
+    template<typename ScalarType>
+    class FilterWorkspace {
+    public:
+        /**
+         * The type of all buffers
+         */
+        using Buffer = Eigen::Matrix<ScalarType, -1, -1>;
+
+        /**
+         * The vector type of all buffers
+         */
+        using VectorBuffer = Eigen::Matrix<ScalarType, -1, 1>;
+
+        /**
+         * The temporaries which depend on the size of the measurement
+         */
+        struct Innovation {
+            Buffer H, R, PHt, S, W;
+            VectorBuffer delta, whitened;
+            Eigen::LLT<Buffer> llt;
+        };
+
+        /**
+         * The Jacobian of the dynamic model
+         */
+        Buffer F;
+
+        /**
+         * The Jacobian of the boxplus function
+         */
+        Buffer D;
+
+        /**
+         * The covariance after the correction, before it is moved to the new state estimate
+         */
+        Buffer P;
+
+        /**
+         * The left product during a covariance transformation A*P*A^T
+         */
+        Buffer AP;
+
+        /**
+         * The covariance of the prior during an iterated update, allocated on its first use
+         */
+        Buffer prior;
+
+    private:
+        /**
+         * The temporaries of each measurement size
+         */
+        std::map<Eigen::Index, Innovation> innovations;
+
+        bool enabled = false;
+
+        /**
+         * The number of active scopes
+         */
+        int depth = 0;
+
+        void release() {
+            F = D = P = AP = prior = Buffer();
+            //Assigning a default constructed LLT would copy its uninitialized state
+            innovations.clear();
+        }
+
+    public:
+        /**
+         * Enables or disables the workspace. A disabled workspace frees its buffers at the end of each step.
+         */
+        void setEnabled(bool enable) {
+            enabled = enable;
+            if (!enabled && depth == 0)
+                release();
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        /**
+         * Allocates the buffers which have the size of the state
+         * @param dof The degrees of freedom of the state
+         */
+        void reserve(Eigen::Index dof) {
+            F.resize(dof, dof);
+            D.resize(dof, dof);
+            P.resize(dof, dof);
+            AP.resize(dof, dof);
+        }
+
+        /**
+         * Allocates the buffers for a measurement size in advance
+         * @param dof The degrees of freedom of the state
+         * @param mdof The degrees of freedom of the measurement
+         */
+        void reserve(Eigen::Index dof, Eigen::Index mdof) {
+            Innovation &buffers = innovation(mdof);
+            buffers.H.resize(mdof, dof);
+            buffers.R.resize(mdof, mdof);
+            buffers.delta.resize(mdof);
+            buffers.PHt.resize(dof, mdof);
+            buffers.S.resize(mdof, mdof);
+            buffers.W.resize(mdof, dof);
+            buffers.whitened.resize(mdof);
+            //Sizes the factor without assigning an LLT with an uninitialized state
+            buffers.llt.compute(Buffer::Identity(mdof, mdof));
+        }
+
+        /**
+         * @param mdof The degrees of freedom of the measurement
+         * @return The temporaries for measurements of the given size
+         */
+        Innovation &innovation(Eigen::Index mdof) {
+            return innovations[mdof];
+        }
+
+        /**
+         * Selects the storage of a temporary. Dynamic sized matrices and their factorizations use the buffer of the
+         * workspace, fixed size types the local object on the stack.
+         * @param local The local object
+         * @param buffer The buffer of the workspace
+         * @return buffer if the types are equal, local otherwise
+         */
+        template<typename Type, typename BufferType>
+        static Type &select(Type &local, BufferType &buffer) {
+            if constexpr (std::is_same<Type, BufferType>::value)
+                return buffer;
+            else
+                return local;
+        }
+
+        /**
+         * Marks a step which uses the workspace. The buffers are freed at the end of the outermost scope if the
+         * workspace is disabled.
+         */
+        class Scope {
+            FilterWorkspace &workspace;
+        public:
+            explicit Scope(FilterWorkspace &_workspace) : workspace(_workspace) {
+                ++workspace.depth;
+            }
+
+            ~Scope() {
+                if (--workspace.depth == 0 && !workspace.enabled)
+                    workspace.release();
+            }
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+        };
+    };
+}
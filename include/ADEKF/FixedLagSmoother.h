@@ -0,0 +1,202 @@
+#pragma once
+
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include "ADEKFUtils.h"
+
+#include <vector>
+
+namespace adekf {
+
+    /**
+     * A fixed lag Rauch-Tung-Striebel smoother which is fed by the predictions of an ADEKF
+     *
+     * For each of the last L predictions, the filtered estimate before the prediction, the Jacobian F of the dynamic
+     * model and the predicted estimate are stored in a circular buffer which is allocated once. smooth() runs the
+     * backward pass from the current filter estimate over these steps and yields the smoothed estimate L steps behind
+     * the filter, so each step costs O(L*DOF^3) independent of the length of the run and does not allocate.
+     *
+     * On manifolds the smoothed offset is calculated with boxminus in the tangent space of the predicted estimate and
+     * added to the filtered estimate with boxplus. The covariances are moved between these references with the
+     * Jacobians of transformReferenceCovariance.
+     * @tparam State The State of the filter
+     */
+    template<typename State>
+    class FixedLagSmoother {
+        /**
+         * The DOF of the State
+         */
+        static constexpr int DOF = DOFOf<State>;
+        using ScalarType = typename StateInfo<State>::ScalarType;
+
+    public:
+        /**
+         * The Covariance type of the State, the same as in the ADEKF
+         */
+        using Covariance = typename std::conditional<dynamicMatrix<DOF, DOF>, Eigen::Matrix<ScalarType, -1, -1>,
+                Eigen::Matrix<ScalarType, DOF, DOF>>::type;
+
+    private:
+        /**
+         * The quantities of one prediction
+         */
+        struct Step {
+            State filteredMu;
+            Covariance filteredSigma;
+            Covariance F;
+            State predictedMu;
+            Covariance predictedSigma;
+        };
+
+        /**
+         * The circular buffer of the last predictions
+         */
+        std::vector<Step> steps;
+
+        /**
+         * The index of the oldest prediction and the number of stored predictions
+         */
+        int first = 0, count = 0;
+
+        /**
+         * Temporaries of the backward pass
+         */
+        Covariance transposedGain, product, difference;
+        Eigen::Matrix<ScalarType, DOF, 1> offset, correction;
+        Eigen::LLT<Covariance> llt;
+
+        /**
+         * @param i The age of a prediction, 0 for the oldest
+         * @return The stored prediction
+         */
+        Step &step(int i) {
+            return steps[(first + i) % lag()];
+        }
+
+        /**
+         * Moves a covariance from the reference ref1 to ref2=ref1+Er1 on manifolds, does nothing on vectors
+         */
+        static void moveReference(const State &ref1, const State &ref2, const Eigen::Matrix<ScalarType, DOF, 1> &Er1,
+                                  Covariance &P) {
+            if constexpr (std::is_base_of_v<Manifold, State>)
+                transformReferenceCovariance(ref1, ref2, Er1, P);
+        }
+
+    public:
+        /**
+         * The smoothed estimate L steps behind the filter, set by smooth()
+         */
+        State mu;
+
+        /**
+         * The covariance of the smoothed estimate
+         */
+        Covariance sigma;
+
+        /**
+         * Allocates the buffer for lag predictions
+         * @param lag The number of steps L between the filter and the smoothed estimate
+         */
+        explicit FixedLagSmoother(int lag) : steps(lag), transposedGain(DOF, DOF), product(DOF, DOF),
+                                             difference(DOF, DOF), llt(DOF), sigma(DOF, DOF) {
+            assert(lag > 0 && "The lag has to be at least one step");
+            for (Step &stored : steps) {
+                stored.filteredSigma.resize(DOF, DOF);
+                stored.F.resize(DOF, DOF);
+                stored.predictedSigma.resize(DOF, DOF);
+            }
+        }
+
+        /**
+         * @return The lag L
+         */
+        int lag() const {
+            return int(steps.size());
+        }
+
+        /**
+         * @return The number of stored predictions, smooth() needs lag() of them
+         */
+        int size() const {
+            return count;
+        }
+
+        /**
+         * Forgets all predictions, e.g. after the filter was reset
+         */
+        void clear() {
+            first = count = 0;
+        }
+
+        /**
+         * Stores the filtered estimate before a prediction, the oldest prediction is overwritten if the buffer is full
+         * @param filteredMu The estimate before the prediction
+         * @param filteredSigma Its covariance
+         */
+        void recordFiltered(const State &filteredMu, const Covariance &filteredSigma) {
+            if (count == lag())
+                first = (first + 1) % lag();
+            else
+                ++count;
+            Step &newest = step(count - 1);
+            newest.filteredMu = filteredMu;
+            newest.filteredSigma = filteredSigma;
+        }
+
+        /**
+         * Stores the result of the prediction which was started by recordFiltered
+         * @param F The Jacobian of the dynamic model at the filtered estimate
+         * @param predictedMu The predicted estimate
+         * @param predictedSigma Its covariance F*P*F^T+Q
+         */
+        template<typename Derived>
+        void recordPredicted(const Eigen::MatrixBase<Derived> &F, const State &predictedMu,
+                             const Covariance &predictedSigma) {
+            assert(count > 0 && "recordFiltered has to be called before the prediction");
+            Step &newest = step(count - 1);
+            newest.F = F;
+            newest.predictedMu = predictedMu;
+            newest.predictedSigma = predictedSigma;
+        }
+
+        /**
+         * Calculates the smoothed estimate L steps behind the filter with the Rauch-Tung-Striebel backward pass
+         *
+         * Starting with the current filter estimate, each step back calculates the gain C=P_f*F^T*P_p^-1 and
+         * x_s=x_f+C*(x_s'-x_p), P_s=P_f+C*(P_s'-P_p)*C^T, where ' denotes the smoothed estimate of the next step.
+         * @param filterMu The current estimate of the filter, after all updates of the current step
+         * @param filterSigma Its covariance
+         * @return false if less than L predictions are stored, mu and sigma are not set then
+         */
+        bool smooth(const State &filterMu, const Covariance &filterSigma) {
+            if (count < lag())
+                return false;
+            mu = filterMu;
+            sigma = filterSigma;
+            for (int i = count - 1; i >= 0; --i) {
+                const Step &current = step(i);
+                //Move the smoothed covariance into the tangent space of the prediction
+                offset = current.predictedMu - mu;
+                moveReference(mu, current.predictedMu, offset, sigma);
+                //The smoothed offset to the prediction
+                offset = mu - current.predictedMu;
+                //C^T=P_p^-1*F*P_f, solved with the Cholesky factor of the symmetric predicted covariance
+                llt.compute(current.predictedSigma);
+                assert(llt.info() == Eigen::Success && "The predicted covariance has to be positive definite");
+                transposedGain.noalias() = current.F * current.filteredSigma;
+                llt.solveInPlace(transposedGain);
+                //P_s=P_f+C*(P_s'-P_p)*C^T
+                difference = sigma - current.predictedSigma;
+                product.noalias() = transposedGain.transpose() * difference;
+                sigma = current.filteredSigma;
+                sigma.noalias() += product * transposedGain;
+                symmetrizeFromLower(sigma);
+                //x_s=x_f+C*(x_s'-x_p), the covariance is moved to the new reference
+                correction.noalias() = transposedGain.transpose() * offset;
+                mu = current.filteredMu + correction;
+                moveReference(current.filteredMu, mu, correction, sigma);
+            }
+            return true;
+        }
+    };
+}
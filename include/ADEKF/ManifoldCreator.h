@@ -57,17 +57,23 @@ BOOST_PP_FOR_1( \
 
 /**
  * Struct to get default values differently for manifolds
+ * The values are created on each call instead of being copied from a shared static, so concurrent filters share no state
  */
 template<typename T>
 struct defaultValue{
-    inline static const T default_value{};};
+    static T value(){
+        return T{};
+    }
+};
 
 /**
  * Struct to get default value (Eigen::Zero()) for Eigen Matrices
  */
 template <typename DERIVED>
 struct defaultValue<Eigen::MatrixBase<DERIVED> >{
-    inline static const DERIVED default_value=DERIVED::Zero();
+    static DERIVED value(){
+        return DERIVED::Zero();
+    }
 };
 
 
@@ -77,7 +83,7 @@ struct defaultValue<Eigen::MatrixBase<DERIVED> >{
 
 #define ADEKF_CONSTRUCTOR_SETTERS(name) name(arg_##name)
 #define ADEKF_SETTERS(name) name=arg_##name;
-#define ADEKF_DEFAULT_CONSTRUCTOR_SETTERS(name) name(defaultValue<typename adekf::StateInfo<decltype(name)>::type>::default_value)
+#define ADEKF_DEFAULT_CONSTRUCTOR_SETTERS(name) name(defaultValue<typename adekf::StateInfo<decltype(name)>::type>::value())
 #define ADEKF_COPY_CONSTRUCTOR(name) name(other.name)
 #define ADEKF_ADD_DOF(name) + ADEKF_GETDOF(name)
 #define ADEKF_ADD_GLOBAL_SIZE(name) + ADEKF_GETGLOBAL(name)
@@ -172,6 +178,10 @@ void function_name(FUNCTOR & functor,  ARGS &&... args) const{\
 template<typename FUNCTOR, typename OtherScalar, typename ... ARGS>\
 void function_name ##WithOther (FUNCTOR & functor,const name<OtherScalar> & other ,ARGS && ... args) const {\
 FOR_EACH_IF_NOT_EMPTY(CALL_FUNCTION_ON_MEMBER_WITH_OTHER,(functor,args,other),m_members)\
+}\
+template<typename FUNCTOR, typename OtherScalar, typename ... ARGS>\
+void function_name ##WithOther (FUNCTOR & functor,name<OtherScalar> & other ,ARGS && ... args) const {\
+FOR_EACH_IF_NOT_EMPTY(CALL_FUNCTION_ON_MEMBER_WITH_OTHER,(functor,args,other),m_members)\
 }
 
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace adekf {
+
+    /**
+     * The sparsity pattern of a Jacobian with a column coloring.
+     *
+     * Two columns get the same color if they have no non zero entry in the same row (Curtis, Powell and Reid 1974).
+     * All columns of one color can then be differentiated with a single dual component, since each non zero entry of
+     * the compressed Jacobian belongs to exactly one column.
+     */
+    struct SparsityPattern {
+        /**
+         * The column indices of the non zero entries of each row
+         */
+        std::vector<std::vector<int>> rows;
+
+        /**
+         * The color of each column
+         */
+        std::vector<int> colors;
+
+        /**
+         * The number of different colors
+         */
+        int numColors = 0;
+
+        SparsityPattern() = default;
+
+        /**
+         * Creates the pattern and colors the columns greedily
+         * @param _rows The column indices of the non zero entries of each row
+         * @param cols The number of columns of the Jacobian
+         */
+        SparsityPattern(std::vector<std::vector<int>> _rows, int cols) : rows(std::move(_rows)), colors(cols, -1) {
+            //The rows in which each column has non zero entries
+            std::vector<std::vector<int>> columns(cols);
+            for (int i = 0; i < (int) rows.size(); ++i)
+                for (int j : rows[i])
+                    columns[j].push_back(i);
+            //Marks the colors which are already used in a row of the current column
+            std::vector<int> forbidden(cols, -1);
+            for (int j = 0; j < cols; ++j) {
+                for (int i : columns[j])
+                    for (int other : rows[i])
+                        if (colors[other] >= 0)
+                            forbidden[colors[other]] = j;
+                int color = 0;
+                while (forbidden[color] == j)
+                    ++color;
+                colors[j] = color;
+                numColors = std::max(numColors, color + 1);
+            }
+        }
+    };
+}
@@ -164,6 +164,7 @@
 #include <string>
 
 #include "Eigen/Core"
+#include "jet_arena.h"
 
 #ifndef  USE_EIGEN_DYNAMIC_THRESHHOLD
 #define USE_EIGEN_DYNAMIC_THRESHHOLD 32
@@ -253,8 +254,9 @@ namespace ceres {
         // The scalar part.
         T a;
 
-        // The infinitesimal part.
-        typename std::conditional<dynamic, Eigen::Matrix<T, -1, 1>, Eigen::Matrix<T, N, 1>>::type v;
+        // The infinitesimal part. Large parts are stored in the JetArena bound to
+        // the current thread or on the heap (see jet_arena.h).
+        typename std::conditional<dynamic, JetArenaVector<T>, Eigen::Matrix<T, N, 1>>::type v;
 
         // This struct needs to have an Eigen aligned operator new as it contains
         // fixed-size Eigen types.
@@ -377,6 +379,27 @@ namespace ceres {
         return Jet<T, N>(f.a * s_inverse, f.v * s_inverse);
     }
 
+// Binary operators with a scalar of another arithmetic type, e.g. a double control vector in a model which is
+// evaluated with float Jets. The scalar is converted to the scalar type of the Jet.
+    template<typename T, typename S>
+    using EnableIfOtherScalar = typename std::enable_if<std::is_arithmetic<S>::value && !std::is_same<S, T>::value, int>::type;
+
+#define CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR(op) \
+template<typename T, int N, typename S, EnableIfOtherScalar<T, S> = 0> inline \
+Jet<T, N> operator op(const Jet<T, N>& f, S s) { \
+  return f op T(s); \
+} \
+template<typename T, int N, typename S, EnableIfOtherScalar<T, S> = 0> inline \
+Jet<T, N> operator op(S s, const Jet<T, N>& g) { \
+  return T(s) op g; \
+}
+
+    CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR(+)  // NOLINT
+    CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR(-)  // NOLINT
+    CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR(*)  // NOLINT
+    CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR(/)  // NOLINT
+#undef CERES_DEFINE_JET_OTHER_SCALAR_OPERATOR
+
 // Binary comparison operators for both scalars and jets.
 #define CERES_DEFINE_JET_COMPARISON_OPERATOR(op) \
 template<typename T, int N> inline \
@@ -997,6 +1020,15 @@ namespace Eigen {
     struct ScalarBinaryOpTraits<T, ceres::Jet<T, N>, BinaryOp> {
         typedef ceres::Jet<T, N> ReturnType;
     };
+    // Mixed precision: double matrices in models which are evaluated with float Jets
+    template<typename BinaryOp, int N>
+    struct ScalarBinaryOpTraits<ceres::Jet<float, N>, double, BinaryOp> {
+        typedef ceres::Jet<float, N> ReturnType;
+    };
+    template<typename BinaryOp, int N>
+    struct ScalarBinaryOpTraits<double, ceres::Jet<float, N>, BinaryOp> {
+        typedef ceres::Jet<float, N> ReturnType;
+    };
 #endif  // EIGEN_VERSION_AT_LEAST(3, 3, 0)
 
 }  // namespace Eigen
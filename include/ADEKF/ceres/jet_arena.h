@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "Eigen/Core"
+
+namespace ceres {
+
+    /**
+     * A bump allocator for the infinitesimal parts of dynamic sized Jets.
+     *
+     * While an arena is bound to the current thread (see JetArena::Scope) every dynamic sized Jet takes its derivative
+     * storage from the arena instead of the general purpose heap. Memory is never freed individually, the whole arena
+     * is reset when the outermost scope ends. After a warm up phase the arena consists of a single block which is
+     * large enough for a whole model evaluation, so further evaluations do not touch the heap at all.
+     *
+     * Jets which take memory from an arena must not outlive the scope which bound the arena. Model code must therefore
+     * not keep dynamic sized Jets in static variables, they would be created inside the scope of the first caller.
+     * Jets which own heap storage, e.g. ones created before the scope, keep using the heap when they are assigned inside
+     * a scope, so they stay valid after it.
+     */
+    class JetArena {
+        /**
+         * A contiguous block of memory of the arena
+         */
+        struct Block {
+            char *data;
+            std::size_t size;
+        };
+
+        /**
+         * The minimum size of a newly allocated block in bytes
+         */
+        static constexpr std::size_t MIN_BLOCK_SIZE = 64 * 1024;
+
+        /**
+         * Alignment of all returned memory. Allows aligned Eigen maps on the derivative parts.
+         */
+        static constexpr std::size_t ALIGNMENT = EIGEN_MAX_ALIGN_BYTES > 0 ? EIGEN_MAX_ALIGN_BYTES : sizeof(double);
+
+        /**
+         * The arena which is currently bound to this thread. nullptr if Jets shall use the heap.
+         */
+        static inline thread_local JetArena *bound = nullptr;
+
+        std::vector<Block> blocks;
+        std::size_t offset = 0;
+        bool enabled = true;
+
+        void addBlock(std::size_t size) {
+            blocks.push_back(Block{static_cast<char *>(Eigen::internal::aligned_malloc(size)), size});
+            offset = 0;
+        }
+
+        void release() {
+            for (Block &block : blocks)
+                Eigen::internal::aligned_free(block.data);
+            blocks.clear();
+            offset = 0;
+        }
+
+    public:
+        /**
+         * Constructs an arena
+         * @param initialCapacity Number of bytes which are reserved directly
+         */
+        explicit JetArena(std::size_t initialCapacity = 0) {
+            if (initialCapacity > 0)
+                addBlock(initialCapacity);
+        }
+
+        /**
+         * Copies only the configuration. The copy gets its own memory.
+         */
+        JetArena(const JetArena &other) : JetArena(other.capacity()) {
+            enabled = other.enabled;
+        }
+
+        JetArena &operator=(const JetArena &other) {
+            enabled = other.enabled;
+            return *this;
+        }
+
+        ~JetArena() {
+            release();
+        }
+
+        /**
+         * Enables or disables the arena. A disabled arena is never bound, Jets use the heap instead.
+         */
+        void setEnabled(bool enable) {
+            enabled = enable;
+        }
+
+        bool isEnabled() const {
+            return enabled;
+        }
+
+        /**
+         * @return The number of bytes currently owned by the arena
+         */
+        std::size_t capacity() const {
+            std::size_t sum = 0;
+            for (const Block &block : blocks)
+                sum += block.size;
+            return sum;
+        }
+
+        /**
+         * Returns aligned memory of the given size which stays valid until the next reset.
+         * @param bytes number of requested bytes
+         * @return pointer to the memory
+         */
+        void *allocate(std::size_t bytes) {
+            bytes = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            if (blocks.empty() || offset + bytes > blocks.back().size) {
+                std::size_t size = blocks.empty() ? MIN_BLOCK_SIZE : 2 * blocks.back().size;
+                addBlock(size < bytes ? bytes : size);
+            }
+            void *result = blocks.back().data + offset;
+            offset += bytes;
+            return result;
+        }
+
+        /**
+         * Invalidates all memory handed out by the arena.
+         *
+         * If the last evaluation needed more than one block, all blocks are merged into a single one so that the
+         * next evaluation of the same size fits without growing.
+         */
+        void reset() {
+            if (blocks.size() > 1) {
+                std::size_t size = capacity();
+                release();
+                addBlock(size);
+            }
+            offset = 0;
+        }
+
+        /**
+         * @return The arena bound to the current thread or nullptr
+         */
+        static JetArena *current() {
+            return bound;
+        }
+
+        /**
+         * Binds an arena to the current thread for the lifetime of the scope.
+         *
+         * When the scope ends, the previously bound arena is restored and the arena is reset, unless the scope was nested
+         * in another scope of the same arena.
+         */
+        class Scope {
+            JetArena *arena;
+            JetArena *previous;
+        public:
+            explicit Scope(JetArena &_arena) : arena(_arena.enabled ? &_arena : nullptr), previous(bound) {
+                if (arena)
+                    bound = arena;
+            }
+
+            ~Scope() {
+                if (arena) {
+                    bound = previous;
+                    if (previous != arena)
+                        arena->reset();
+                }
+            }
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+        };
+
+        /**
+         * Unbinds any arena from the current thread for the lifetime of the object.
+         *
+         * Used for Jets which outlive the current scope e.g. static seed vectors.
+         */
+        class Suspend {
+            JetArena *previous;
+        public:
+            Suspend() : previous(bound) {
+                bound = nullptr;
+            }
+
+            ~Suspend() {
+                bound = previous;
+            }
+
+            Suspend(const Suspend &) = delete;
+
+            Suspend &operator=(const Suspend &) = delete;
+        };
+    };
+
+    /**
+     * Dynamic sized vector which stores the infinitesimal part of large Jets.
+     *
+     * Behaves like an Eigen::Map on its storage. The storage is taken from the JetArena bound to the current thread or
+     * from the heap if no arena is bound.
+     * @tparam T The scalar type of the vector
+     */
+    template<typename T>
+    class JetArenaVector : public Eigen::Map<Eigen::Matrix<T, -1, 1>, Eigen::AlignedMax> {
+        using Base = Eigen::Map<Eigen::Matrix<T, -1, 1>, Eigen::AlignedMax>;
+        /**
+         * Whether the storage is owned on the heap and has to be freed
+         */
+        bool owned = false;
+
+        void release() {
+            if (owned)
+                Eigen::internal::aligned_free(this->data());
+            owned = false;
+        }
+
+        /**
+         * Ensures that the vector has storage for exactly size entries. Content is undefined afterwards.
+         */
+        void allocate(Eigen::Index size) {
+            if (size == this->size())
+                return;
+            //Heap storage may outlive the current scope, so it is not replaced by arena storage
+            JetArena *arena = owned ? nullptr : JetArena::current();
+            release();
+            T *data = nullptr;
+            if (size > 0) {
+                owned = arena == nullptr;
+                data = static_cast<T *>(owned ? Eigen::internal::aligned_malloc(size * sizeof(T))
+                                              : arena->allocate(size * sizeof(T)));
+            }
+            //Placement new is the documented way to change the array of an Eigen::Map
+            new(static_cast<Base *>(this)) Base(data, size);
+        }
+
+    public:
+        JetArenaVector() : Base(nullptr, 0) {}
+
+        JetArenaVector(const JetArenaVector &other) : Base(nullptr, 0) {
+            allocate(other.size());
+            Base::operator=(other);
+        }
+
+        JetArenaVector(JetArenaVector &&other) noexcept: Base(other.data(), other.size()), owned(other.owned) {
+            other.owned = false;
+            new(static_cast<Base *>(&other)) Base(nullptr, 0);
+        }
+
+        template<typename Derived>
+        JetArenaVector(const Eigen::DenseBase<Derived> &other) : Base(nullptr, 0) {
+            allocate(other.size());
+            Base::operator=(other);
+        }
+
+        ~JetArenaVector() {
+            release();
+        }
+
+        JetArenaVector &operator=(const JetArenaVector &other) {
+            if (this != &other) {
+                allocate(other.size());
+                Base::operator=(other);
+            }
+            return *this;
+        }
+
+        JetArenaVector &operator=(JetArenaVector &&other) {
+            //Arena storage is copied into a vector on the heap instead of being stolen, the target may outlive the scope
+            if (owned && !other.owned)
+                return *this = other;
+            if (this != &other) {
+                release();
+                owned = other.owned;
+                new(static_cast<Base *>(this)) Base(other.data(), other.size());
+                other.owned = false;
+                new(static_cast<Base *>(&other)) Base(nullptr, 0);
+            }
+            return *this;
+        }
+
+        template<typename Derived>
+        JetArenaVector &operator=(const Eigen::DenseBase<Derived> &other) {
+            //Expressions may alias this vector, they have the same size then and no reallocation takes place
+            allocate(other.size());
+            Base::operator=(other);
+            return *this;
+        }
+
+        /**
+         * Resizes the vector and sets all entries to zero
+         * @param size the new size
+         */
+        JetArenaVector &setZero(Eigen::Index size) {
+            allocate(size);
+            Base::setZero();
+            return *this;
+        }
+
+        JetArenaVector &setZero() {
+            Base::setZero();
+            return *this;
+        }
+    };
+}
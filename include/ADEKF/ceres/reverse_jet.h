@@ -0,0 +1,553 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "Eigen/Core"
+
+namespace ceres {
+
+    /**
+     * Records the operations of ReverseJets for reverse mode differentiation.
+     *
+     * Each operation on a ReverseJet which depends on an input appends a node with the partial derivatives to its
+     * (at most two) arguments. A reverse sweep from an output node accumulates the adjoints back to the inputs, which
+     * results in the gradient of the output. The cost of a gradient is proportional to the number of recorded
+     * operations instead of the number of inputs.
+     *
+     * While a tape is bound to the current thread (see ReverseTape::Scope) every ReverseJet records on it.
+     * The memory of the tape is kept between evaluations, so after a warm up phase recording does not touch the heap.
+     * @tparam T The scalar type of the values and derivatives
+     */
+    template<typename T>
+    class ReverseTape {
+        /**
+         * A recorded operation with the indices of its arguments and the partial derivatives to them.
+         * Unused arguments have the index -1.
+         */
+        struct Node {
+            int parents[2];
+            T partials[2];
+        };
+
+        /**
+         * The tape which is currently bound to this thread
+         */
+        static inline thread_local ReverseTape *bound = nullptr;
+
+        std::vector<Node> nodes;
+        std::vector<T> adjoints;
+        int inputs = 0;
+
+    public:
+        ReverseTape() = default;
+
+        /**
+         * Copies only the configuration. The copy gets its own memory.
+         */
+        ReverseTape(const ReverseTape &) {}
+
+        ReverseTape &operator=(const ReverseTape &) {
+            return *this;
+        }
+
+        /**
+         * Clears the tape and registers the inputs with the indices 0 to numInputs-1
+         * @param numInputs the number of inputs
+         */
+        void reset(int numInputs) {
+            nodes.assign(numInputs, Node{{-1, -1}, {T(0), T(0)}});
+            inputs = numInputs;
+        }
+
+        /**
+         * Records an operation
+         * @param parent1 index of the first argument or -1
+         * @param partial1 partial derivative to the first argument
+         * @param parent2 index of the second argument or -1
+         * @param partial2 partial derivative to the second argument
+         * @return the index of the result
+         */
+        int record(int parent1, const T &partial1, int parent2 = -1, const T &partial2 = T(0)) {
+            nodes.push_back(Node{{parent1, parent2}, {partial1, partial2}});
+            return static_cast<int>(nodes.size()) - 1;
+        }
+
+        /**
+         * @return the number of recorded nodes including the inputs
+         */
+        int size() const {
+            return static_cast<int>(nodes.size());
+        }
+
+        /**
+         * Calculates the gradient of a recorded output with respect to the inputs by a reverse sweep
+         * @param output the index of the output, -1 for constants
+         * @param gradient the resulting row vector of size numInputs
+         */
+        template<typename Derived>
+        void gradient(int output, const Eigen::MatrixBase<Derived> &gradient) {
+            //Eigen's recommended way to write into temporary blocks
+            Eigen::MatrixBase<Derived> &out = const_cast<Eigen::MatrixBase<Derived> &>(gradient);
+            out.setZero();
+            if (output < 0)
+                return;
+            adjoints.assign(output + 1, T(0));
+            adjoints[output] = T(1);
+            //Inputs have no arguments, so the sweep can stop at the first operation
+            for (int i = output; i >= inputs; --i) {
+                const T adjoint = adjoints[i];
+                if (adjoint == T(0))
+                    continue;
+                const Node &node = nodes[i];
+                for (int k = 0; k < 2; ++k)
+                    if (node.parents[k] >= 0)
+                        adjoints[node.parents[k]] += node.partials[k] * adjoint;
+            }
+            for (int i = 0; i < inputs && i <= output; ++i)
+                out(i) = adjoints[i];
+        }
+
+        /**
+         * @return The tape bound to the current thread or nullptr
+         */
+        static ReverseTape *current() {
+            return bound;
+        }
+
+        /**
+         * Binds a tape to the current thread and registers the inputs for the lifetime of the scope.
+         *
+         * When the scope ends, the previously bound tape is restored.
+         */
+        class Scope {
+            ReverseTape *previous;
+        public:
+            Scope(ReverseTape &tape, int numInputs) : previous(bound) {
+                tape.reset(numInputs);
+                bound = &tape;
+            }
+
+            ~Scope() {
+                bound = previous;
+            }
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+        };
+    };
+
+    /**
+     * A scalar which records its operations on the bound ReverseTape.
+     *
+     * Stores only its value and the index of its node on the tape. Constants have the index -1 and are not recorded.
+     * @tparam T The scalar type
+     * @tparam N The number of inputs (only used for type distinction with the other Jets)
+     */
+    template<typename T, int N>
+    struct ReverseJet {
+        enum {
+            DIMENSION = N
+        };
+        typedef T Scalar;
+
+        ReverseJet() : a(), index(-1) {}
+
+        // Constructor from scalar: a constant
+        explicit ReverseJet(const T &value) : a(value), index(-1) {}
+
+        // Constructor from scalar and node index on the tape
+        ReverseJet(const T &value, int k) : a(value), index(k) {}
+
+        ReverseJet &operator+=(const ReverseJet &y) {
+            return *this = *this + y;
+        }
+
+        ReverseJet &operator-=(const ReverseJet &y) {
+            return *this = *this - y;
+        }
+
+        ReverseJet &operator*=(const ReverseJet &y) {
+            return *this = *this * y;
+        }
+
+        ReverseJet &operator/=(const ReverseJet &y) {
+            return *this = *this / y;
+        }
+
+        ReverseJet &operator+=(const T &s) {
+            a += s;
+            return *this;
+        }
+
+        ReverseJet &operator-=(const T &s) {
+            a -= s;
+            return *this;
+        }
+
+        ReverseJet &operator*=(const T &s) {
+            return *this = *this * s;
+        }
+
+        ReverseJet &operator/=(const T &s) {
+            return *this = *this / s;
+        }
+
+        // The scalar part.
+        T a;
+
+        // The index of the node on the tape, -1 for constants
+        int index;
+    };
+
+    /**
+     * Records a function with derivative df at f.a
+     */
+    template<typename T, int N>
+    inline ReverseJet<T, N> reverseChain(const T &value, const T &df, const ReverseJet<T, N> &f) {
+        if (f.index < 0)
+            return ReverseJet<T, N>(value);
+        assert(ReverseTape<T>::current() && "ReverseJets need a bound ReverseTape");
+        return ReverseJet<T, N>(value, ReverseTape<T>::current()->record(f.index, df));
+    }
+
+    /**
+     * Records a binary function with partial derivatives df and dg
+     */
+    template<typename T, int N>
+    inline ReverseJet<T, N>
+    reverseChain(const T &value, const T &df, const ReverseJet<T, N> &f, const T &dg, const ReverseJet<T, N> &g) {
+        if (f.index < 0)
+            return reverseChain(value, dg, g);
+        if (g.index < 0)
+            return reverseChain(value, df, f);
+        assert(ReverseTape<T>::current() && "ReverseJets need a bound ReverseTape");
+        return ReverseJet<T, N>(value, ReverseTape<T>::current()->record(f.index, df, g.index, dg));
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> const &operator+(const ReverseJet<T, N> &f) {
+        return f;
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator-(const ReverseJet<T, N> &f) {
+        return reverseChain(-f.a, T(-1.0), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator+(const ReverseJet<T, N> &f, const ReverseJet<T, N> &g) {
+        return reverseChain(f.a + g.a, T(1.0), f, T(1.0), g);
+    }
+
+    // Adding a constant does not change the derivatives, so the node is shared
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator+(const ReverseJet<T, N> &f, T s) {
+        return ReverseJet<T, N>(f.a + s, f.index);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator+(T s, const ReverseJet<T, N> &f) {
+        return ReverseJet<T, N>(f.a + s, f.index);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator-(const ReverseJet<T, N> &f, const ReverseJet<T, N> &g) {
+        return reverseChain(f.a - g.a, T(1.0), f, T(-1.0), g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator-(const ReverseJet<T, N> &f, T s) {
+        return ReverseJet<T, N>(f.a - s, f.index);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator-(T s, const ReverseJet<T, N> &f) {
+        return reverseChain(s - f.a, T(-1.0), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator*(const ReverseJet<T, N> &f, const ReverseJet<T, N> &g) {
+        return reverseChain(f.a * g.a, g.a, f, f.a, g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator*(const ReverseJet<T, N> &f, T s) {
+        return reverseChain(f.a * s, s, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator*(T s, const ReverseJet<T, N> &f) {
+        return reverseChain(f.a * s, s, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator/(const ReverseJet<T, N> &f, const ReverseJet<T, N> &g) {
+        const T g_a_inverse = T(1.0) / g.a;
+        const T f_a_by_g_a = f.a * g_a_inverse;
+        return reverseChain(f_a_by_g_a, g_a_inverse, f, -f_a_by_g_a * g_a_inverse, g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator/(T s, const ReverseJet<T, N> &g) {
+        return reverseChain(s / g.a, -s / (g.a * g.a), g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> operator/(const ReverseJet<T, N> &f, T s) {
+        const T s_inverse = T(1.0) / s;
+        return reverseChain(f.a * s_inverse, s_inverse, f);
+    }
+
+// Binary comparison operators for both scalars and reverse jets.
+#define CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(op) \
+template<typename T, int N> inline \
+bool operator op(const ReverseJet<T, N>& f, const ReverseJet<T, N>& g) { \
+  return f.a op g.a; \
+} \
+template<typename T, int N> inline \
+bool operator op(const T& s, const ReverseJet<T, N>& g) { \
+  return s op g.a; \
+} \
+template<typename T, int N> inline \
+bool operator op(const ReverseJet<T, N>& f, const T& s) { \
+  return f.a op s; \
+}
+
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(<)  // NOLINT
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(<=)  // NOLINT
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(>)  // NOLINT
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(>=)  // NOLINT
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(==)  // NOLINT
+    CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR(!=)  // NOLINT
+#undef CERES_DEFINE_REVERSE_JET_COMPARISON_OPERATOR
+
+// The derivatives are the same as for ceres::Jet, see jet.h
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> abs(const ReverseJet<T, N> &f) {
+        return f.a < T(0.0) ? -f : f;
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> log(const ReverseJet<T, N> &f) {
+        return reverseChain(std::log(f.a), T(1.0) / f.a, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> exp(const ReverseJet<T, N> &f) {
+        const T tmp = std::exp(f.a);
+        return reverseChain(tmp, tmp, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> sqrt(const ReverseJet<T, N> &f) {
+        const T tmp = std::sqrt(f.a);
+        return reverseChain(tmp, T(1.0) / (T(2.0) * tmp), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> cos(const ReverseJet<T, N> &f) {
+        return reverseChain(std::cos(f.a), -std::sin(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> acos(const ReverseJet<T, N> &f) {
+        return reverseChain(std::acos(f.a), -T(1.0) / std::sqrt(T(1.0) - f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> sin(const ReverseJet<T, N> &f) {
+        return reverseChain(std::sin(f.a), std::cos(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> asin(const ReverseJet<T, N> &f) {
+        return reverseChain(std::asin(f.a), T(1.0) / std::sqrt(T(1.0) - f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> tan(const ReverseJet<T, N> &f) {
+        const T tan_a = std::tan(f.a);
+        return reverseChain(tan_a, T(1.0) + tan_a * tan_a, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> atan(const ReverseJet<T, N> &f) {
+        return reverseChain(std::atan(f.a), T(1.0) / (T(1.0) + f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> sinh(const ReverseJet<T, N> &f) {
+        return reverseChain(std::sinh(f.a), std::cosh(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> cosh(const ReverseJet<T, N> &f) {
+        return reverseChain(std::cosh(f.a), std::sinh(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> tanh(const ReverseJet<T, N> &f) {
+        const T tanh_a = std::tanh(f.a);
+        return reverseChain(tanh_a, T(1.0) - tanh_a * tanh_a, f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> floor(const ReverseJet<T, N> &f) {
+        return ReverseJet<T, N>(std::floor(f.a));
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> ceil(const ReverseJet<T, N> &f) {
+        return ReverseJet<T, N>(std::ceil(f.a));
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> cbrt(const ReverseJet<T, N> &f) {
+        return reverseChain(std::cbrt(f.a), T(1.0) / (T(3.0) * std::cbrt(f.a * f.a)), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> exp2(const ReverseJet<T, N> &f) {
+        const T tmp = std::exp2(f.a);
+        return reverseChain(tmp, tmp * std::log(T(2)), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> log2(const ReverseJet<T, N> &f) {
+        return reverseChain(std::log2(f.a), T(1.0) / (f.a * std::log(T(2))), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> hypot(const ReverseJet<T, N> &x, const ReverseJet<T, N> &y) {
+        const T tmp = std::hypot(x.a, y.a);
+        return reverseChain(tmp, x.a / tmp, x, y.a / tmp, y);
+    }
+
+    template<typename T, int N>
+    inline const ReverseJet<T, N> &fmax(const ReverseJet<T, N> &x, const ReverseJet<T, N> &y) {
+        return x < y ? y : x;
+    }
+
+    template<typename T, int N>
+    inline const ReverseJet<T, N> &fmin(const ReverseJet<T, N> &x, const ReverseJet<T, N> &y) {
+        return y < x ? y : x;
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> atan2(const ReverseJet<T, N> &g, const ReverseJet<T, N> &f) {
+        T const tmp = T(1.0) / (f.a * f.a + g.a * g.a);
+        return reverseChain(std::atan2(g.a, f.a), -g.a * tmp, f, f.a * tmp, g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> pow(const ReverseJet<T, N> &f, double g) {
+        return reverseChain(std::pow(f.a, g), T(g * std::pow(f.a, g - T(1.0))), f);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> pow(double f, const ReverseJet<T, N> &g) {
+        if (f == 0 && g.a > 0)
+            return ReverseJet<T, N>(T(0.0));
+        T const tmp = std::pow(f, g.a);
+        return reverseChain(tmp, T(std::log(f) * tmp), g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> pow(const ReverseJet<T, N> &f, const ReverseJet<T, N> &g) {
+        if (f.a == 0 && g.a >= 1) {
+            if (g.a > 1)
+                return ReverseJet<T, N>(T(0.0));
+            return f;
+        }
+        T const tmp1 = std::pow(f.a, g.a);
+        T const tmp2 = g.a * std::pow(f.a, g.a - T(1.0));
+        T const tmp3 = tmp1 * std::log(f.a);
+        return reverseChain(tmp1, tmp2, f, tmp3, g);
+    }
+
+    template<typename T, int N>
+    inline ReverseJet<T, N> fmod(const ReverseJet<T, N> numer, T denom) {
+        return ReverseJet<T, N>(std::fmod(numer.a, denom), numer.index);
+    }
+
+    template<typename T, int N>
+    inline bool isfinite(const ReverseJet<T, N> &f) {
+        return std::isfinite(f.a);
+    }
+
+    template<typename T, int N>
+    inline bool isinf(const ReverseJet<T, N> &f) {
+        return std::isinf(f.a);
+    }
+
+    template<typename T, int N>
+    inline bool isnan(const ReverseJet<T, N> &f) {
+        return std::isnan(f.a);
+    }
+
+    template<typename T, int N>
+    inline std::ostream &operator<<(std::ostream &s, const ReverseJet<T, N> &z) {
+        return s << "[" << z.a << " ; #" << z.index << "]";
+    }
+
+}  // namespace ceres
+
+namespace Eigen {
+
+    template<typename T, int N>
+    struct NumTraits<ceres::ReverseJet<T, N>> {
+        typedef ceres::ReverseJet<T, N> Real;
+        typedef ceres::ReverseJet<T, N> NonInteger;
+        typedef ceres::ReverseJet<T, N> Nested;
+        typedef ceres::ReverseJet<T, N> Literal;
+
+        static typename ceres::ReverseJet<T, N> dummy_precision() {
+            return ceres::ReverseJet<T, N>(1e-12);
+        }
+
+        static inline Real epsilon() {
+            return Real(std::numeric_limits<T>::epsilon());
+        }
+
+        static inline int digits10() { return NumTraits<T>::digits10(); }
+
+        enum {
+            IsComplex = 0,
+            IsInteger = 0,
+            IsSigned,
+            ReadCost = 1,
+            AddCost = 1,
+            MulCost = 3,
+            HasFloatingPoint = 1,
+            RequireInitialization = 1
+        };
+
+        template<bool Vectorized>
+        struct Div {
+            enum {
+                AVX = false,
+                Cost = 3
+            };
+        };
+
+        static inline Real highest() { return Real(std::numeric_limits<T>::max()); }
+
+        static inline Real lowest() { return Real(-std::numeric_limits<T>::max()); }
+    };
+
+    template<typename BinaryOp, typename T, int N>
+    struct ScalarBinaryOpTraits<ceres::ReverseJet<T, N>, T, BinaryOp> {
+        typedef ceres::ReverseJet<T, N> ReturnType;
+    };
+    template<typename BinaryOp, typename T, int N>
+    struct ScalarBinaryOpTraits<T, ceres::ReverseJet<T, N>, BinaryOp> {
+        typedef ceres::ReverseJet<T, N> ReturnType;
+    };
+
+}  // namespace Eigen
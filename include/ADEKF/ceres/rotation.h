@@ -395,7 +395,8 @@ namespace ceres {
     void AngleAxisToRotationMatrix(
             const T* angle_axis,
             const MatrixAdapter<T, row_stride, col_stride>& R) {
-        static const T kOne = T(1.0);
+        //Not static: a dynamic sized Jet created during a filter step would keep its derivatives in the JetArena
+        const T kOne = T(1.0);
         const T theta2 = DotProduct(angle_axis, angle_axis);
         if (theta2 > T(std::numeric_limits<double>::epsilon())) {
             // We want to be careful to only evaluate the square root if the
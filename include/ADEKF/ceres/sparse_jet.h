@@ -0,0 +1,640 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "Eigen/Core"
+#include "jet_arena.h"
+
+namespace ceres {
+
+    /**
+     * The sparse infinitesimal part of a SparseJet.
+     *
+     * Stores the non zero derivatives as sorted (index, value) pairs. The storage is taken from the JetArena bound to
+     * the current thread or from the heap if no arena is bound.
+     * All operations cost O(nnz) instead of O(N) for the dense parts of ceres::Jet.
+     * @tparam T The scalar type of the derivatives
+     */
+    template<typename T>
+    class SparseJetPart {
+        T *values_ = nullptr;
+        int *indices_ = nullptr;
+        int nnz_ = 0;
+        bool owned_ = false;
+
+        void release() {
+            if (owned_)
+                Eigen::internal::aligned_free(values_);
+            values_ = nullptr;
+            indices_ = nullptr;
+            nnz_ = 0;
+            owned_ = false;
+        }
+
+        /**
+         * Allocates storage for nnz entries. Previous content is released.
+         */
+        void allocate(int nnz) {
+            //Heap storage may outlive the current scope, so it is not replaced by arena storage
+            JetArena *arena = owned_ ? nullptr : JetArena::current();
+            release();
+            if (nnz == 0)
+                return;
+            std::size_t bytes = nnz * (sizeof(T) + sizeof(int));
+            owned_ = arena == nullptr;
+            values_ = static_cast<T *>(owned_ ? Eigen::internal::aligned_malloc(bytes) : arena->allocate(bytes));
+            indices_ = reinterpret_cast<int *>(values_ + nnz);
+            nnz_ = nnz;
+        }
+
+        void copyFrom(const SparseJetPart &other) {
+            allocate(other.nnz_);
+            std::copy(other.values_, other.values_ + nnz_, values_);
+            std::copy(other.indices_, other.indices_ + nnz_, indices_);
+        }
+
+    public:
+        SparseJetPart() = default;
+
+        /**
+         * Creates a part with a single non zero entry
+         * @param index the index of the entry
+         * @param value the value of the entry
+         */
+        SparseJetPart(int index, const T &value) {
+            allocate(1);
+            values_[0] = value;
+            indices_[0] = index;
+        }
+
+        SparseJetPart(const SparseJetPart &other) {
+            copyFrom(other);
+        }
+
+        SparseJetPart(SparseJetPart &&other) noexcept: values_(other.values_), indices_(other.indices_),
+                                                      nnz_(other.nnz_), owned_(other.owned_) {
+            other.owned_ = false;
+            other.release();
+        }
+
+        ~SparseJetPart() {
+            release();
+        }
+
+        SparseJetPart &operator=(const SparseJetPart &other) {
+            if (this != &other)
+                copyFrom(other);
+            return *this;
+        }
+
+        SparseJetPart &operator=(SparseJetPart &&other) {
+            //Arena storage is copied into a part on the heap instead of being stolen, the target may outlive the scope
+            if (owned_ && !other.owned_)
+                return *this = other;
+            if (this != &other) {
+                release();
+                values_ = other.values_;
+                indices_ = other.indices_;
+                nnz_ = other.nnz_;
+                owned_ = other.owned_;
+                other.owned_ = false;
+                other.release();
+            }
+            return *this;
+        }
+
+        /**
+         * @return The number of stored entries
+         */
+        int nonZeros() const {
+            return nnz_;
+        }
+
+        /**
+         * @return The index of the k-th stored entry
+         */
+        int index(int k) const {
+            return indices_[k];
+        }
+
+        /**
+         * @return The value of the k-th stored entry
+         */
+        const T &value(int k) const {
+            return values_[k];
+        }
+
+        T &value(int k) {
+            return values_[k];
+        }
+
+        /**
+         * Random access to the derivative with respect to the i-th variable. O(log(nnz))
+         */
+        T operator[](int i) const {
+            const int *found = std::lower_bound(indices_, indices_ + nnz_, i);
+            return found != indices_ + nnz_ && *found == i ? values_[found - indices_] : T(0);
+        }
+
+        /**
+         * Calculates alpha * x + beta * y by merging the sorted entries
+         */
+        static SparseJetPart combine(const T &alpha, const SparseJetPart &x, const T &beta, const SparseJetPart &y) {
+            SparseJetPart result;
+            result.allocate(x.nnz_ + y.nnz_);
+            int i = 0, j = 0, k = 0;
+            while (i < x.nnz_ || j < y.nnz_) {
+                if (j == y.nnz_ || (i < x.nnz_ && x.indices_[i] < y.indices_[j])) {
+                    result.indices_[k] = x.indices_[i];
+                    result.values_[k] = alpha * x.values_[i++];
+                } else if (i == x.nnz_ || y.indices_[j] < x.indices_[i]) {
+                    result.indices_[k] = y.indices_[j];
+                    result.values_[k] = beta * y.values_[j++];
+                } else {
+                    result.indices_[k] = x.indices_[i];
+                    result.values_[k] = alpha * x.values_[i++] + beta * y.values_[j++];
+                }
+                ++k;
+            }
+            //The merged part may contain less entries than allocated, the surplus stays unused
+            result.nnz_ = k;
+            return result;
+        }
+
+        /**
+         * Calculates alpha * x
+         */
+        static SparseJetPart scaled(const T &alpha, const SparseJetPart &x) {
+            SparseJetPart result;
+            result.allocate(x.nnz_);
+            for (int k = 0; k < x.nnz_; ++k) {
+                result.indices_[k] = x.indices_[k];
+                result.values_[k] = alpha * x.values_[k];
+            }
+            return result;
+        }
+
+        /**
+         * Writes the entries into a dense vector. All other entries are set to zero.
+         */
+        template<typename Derived>
+        void toDense(const Eigen::MatrixBase<Derived> &dense) const {
+            //Eigen's recommended way to write into temporary blocks
+            Eigen::MatrixBase<Derived> &out = const_cast<Eigen::MatrixBase<Derived> &>(dense);
+            out.setZero();
+            for (int k = 0; k < nnz_; ++k)
+                out(indices_[k]) = values_[k];
+        }
+
+        /**
+         * Visits all stored entries with functor(index,value)
+         */
+        template<typename Functor>
+        void forEach(Functor functor) const {
+            for (int k = 0; k < nnz_; ++k)
+                functor(indices_[k], values_[k]);
+        }
+    };
+
+    //Arithmetic on sparse parts so that generic code like a * f.v + b * g.v works for both Jet types
+    template<typename T>
+    inline SparseJetPart<T> operator+(const SparseJetPart<T> &x, const SparseJetPart<T> &y) {
+        return SparseJetPart<T>::combine(T(1), x, T(1), y);
+    }
+
+    template<typename T>
+    inline SparseJetPart<T> operator-(const SparseJetPart<T> &x, const SparseJetPart<T> &y) {
+        return SparseJetPart<T>::combine(T(1), x, T(-1), y);
+    }
+
+    template<typename T>
+    inline SparseJetPart<T> operator-(const SparseJetPart<T> &x) {
+        return SparseJetPart<T>::scaled(T(-1), x);
+    }
+
+    template<typename T>
+    inline SparseJetPart<T> operator*(const T &s, const SparseJetPart<T> &x) {
+        return SparseJetPart<T>::scaled(s, x);
+    }
+
+    template<typename T>
+    inline SparseJetPart<T> operator*(const SparseJetPart<T> &x, const T &s) {
+        return SparseJetPart<T>::scaled(s, x);
+    }
+
+    /**
+     * A dual number with a sparse infinitesimal part.
+     *
+     * Behaves like ceres::Jet<T,N> but only stores the non zero derivatives. Models which only read a few entries of
+     * a large state produce results whose derivatives have only a few entries, so each operation is O(nnz) instead of O(N).
+     * @tparam T The scalar type
+     * @tparam N The number of variables (only used for type distinction with the dense Jets)
+     */
+    template<typename T, int N>
+    struct SparseJet {
+        enum {
+            DIMENSION = N
+        };
+        typedef T Scalar;
+
+        SparseJet() : a() {}
+
+        // Constructor from scalar: a + 0.
+        explicit SparseJet(const T &value) : a(value) {}
+
+        // Constructor from scalar plus variable: a + t_k.
+        SparseJet(const T &value, int k) : a(value), v(k, T(1.0)) {}
+
+        // Constructor from scalar and sparse part
+        SparseJet(const T &value, SparseJetPart<T> part) : a(value), v(std::move(part)) {}
+
+        SparseJet &operator+=(const SparseJet &y) {
+            return *this = *this + y;
+        }
+
+        SparseJet &operator-=(const SparseJet &y) {
+            return *this = *this - y;
+        }
+
+        SparseJet &operator*=(const SparseJet &y) {
+            return *this = *this * y;
+        }
+
+        SparseJet &operator/=(const SparseJet &y) {
+            return *this = *this / y;
+        }
+
+        SparseJet &operator+=(const T &s) {
+            a += s;
+            return *this;
+        }
+
+        SparseJet &operator-=(const T &s) {
+            a -= s;
+            return *this;
+        }
+
+        SparseJet &operator*=(const T &s) {
+            return *this = *this * s;
+        }
+
+        SparseJet &operator/=(const T &s) {
+            return *this = *this / s;
+        }
+
+        // The scalar part.
+        T a;
+
+        // The sparse infinitesimal part.
+        SparseJetPart<T> v;
+    };
+
+    /**
+     * Applies the chain rule of a function with derivative df at f.a
+     */
+    template<typename T, int N>
+    inline SparseJet<T, N> sparseChain(const T &value, const T &df, const SparseJet<T, N> &f) {
+        return SparseJet<T, N>(value, SparseJetPart<T>::scaled(df, f.v));
+    }
+
+    /**
+     * Applies the chain rule of a binary function with partial derivatives df and dg
+     */
+    template<typename T, int N>
+    inline SparseJet<T, N>
+    sparseChain(const T &value, const T &df, const SparseJet<T, N> &f, const T &dg, const SparseJet<T, N> &g) {
+        return SparseJet<T, N>(value, SparseJetPart<T>::combine(df, f.v, dg, g.v));
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> const &operator+(const SparseJet<T, N> &f) {
+        return f;
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator-(const SparseJet<T, N> &f) {
+        return sparseChain(-f.a, T(-1.0), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator+(const SparseJet<T, N> &f, const SparseJet<T, N> &g) {
+        return sparseChain(f.a + g.a, T(1.0), f, T(1.0), g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator+(const SparseJet<T, N> &f, T s) {
+        return SparseJet<T, N>(f.a + s, f.v);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator+(T s, const SparseJet<T, N> &f) {
+        return SparseJet<T, N>(f.a + s, f.v);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator-(const SparseJet<T, N> &f, const SparseJet<T, N> &g) {
+        return sparseChain(f.a - g.a, T(1.0), f, T(-1.0), g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator-(const SparseJet<T, N> &f, T s) {
+        return SparseJet<T, N>(f.a - s, f.v);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator-(T s, const SparseJet<T, N> &f) {
+        return sparseChain(s - f.a, T(-1.0), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator*(const SparseJet<T, N> &f, const SparseJet<T, N> &g) {
+        return sparseChain(f.a * g.a, g.a, f, f.a, g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator*(const SparseJet<T, N> &f, T s) {
+        return sparseChain(f.a * s, s, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator*(T s, const SparseJet<T, N> &f) {
+        return sparseChain(f.a * s, s, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator/(const SparseJet<T, N> &f, const SparseJet<T, N> &g) {
+        const T g_a_inverse = T(1.0) / g.a;
+        const T f_a_by_g_a = f.a * g_a_inverse;
+        return sparseChain(f_a_by_g_a, g_a_inverse, f, -f_a_by_g_a * g_a_inverse, g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator/(T s, const SparseJet<T, N> &g) {
+        return sparseChain(s / g.a, -s / (g.a * g.a), g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> operator/(const SparseJet<T, N> &f, T s) {
+        const T s_inverse = T(1.0) / s;
+        return sparseChain(f.a * s_inverse, s_inverse, f);
+    }
+
+// Binary comparison operators for both scalars and sparse jets.
+#define CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(op) \
+template<typename T, int N> inline \
+bool operator op(const SparseJet<T, N>& f, const SparseJet<T, N>& g) { \
+  return f.a op g.a; \
+} \
+template<typename T, int N> inline \
+bool operator op(const T& s, const SparseJet<T, N>& g) { \
+  return s op g.a; \
+} \
+template<typename T, int N> inline \
+bool operator op(const SparseJet<T, N>& f, const T& s) { \
+  return f.a op s; \
+}
+
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(<)  // NOLINT
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(<=)  // NOLINT
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(>)  // NOLINT
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(>=)  // NOLINT
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(==)  // NOLINT
+    CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR(!=)  // NOLINT
+#undef CERES_DEFINE_SPARSE_JET_COMPARISON_OPERATOR
+
+// The derivatives are the same as for ceres::Jet, see jet.h
+
+    template<typename T, int N>
+    inline SparseJet<T, N> abs(const SparseJet<T, N> &f) {
+        return f.a < T(0.0) ? -f : f;
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> log(const SparseJet<T, N> &f) {
+        return sparseChain(std::log(f.a), T(1.0) / f.a, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> exp(const SparseJet<T, N> &f) {
+        const T tmp = std::exp(f.a);
+        return sparseChain(tmp, tmp, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> sqrt(const SparseJet<T, N> &f) {
+        const T tmp = std::sqrt(f.a);
+        return sparseChain(tmp, T(1.0) / (T(2.0) * tmp), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> cos(const SparseJet<T, N> &f) {
+        return sparseChain(std::cos(f.a), -std::sin(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> acos(const SparseJet<T, N> &f) {
+        return sparseChain(std::acos(f.a), -T(1.0) / std::sqrt(T(1.0) - f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> sin(const SparseJet<T, N> &f) {
+        return sparseChain(std::sin(f.a), std::cos(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> asin(const SparseJet<T, N> &f) {
+        return sparseChain(std::asin(f.a), T(1.0) / std::sqrt(T(1.0) - f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> tan(const SparseJet<T, N> &f) {
+        const T tan_a = std::tan(f.a);
+        return sparseChain(tan_a, T(1.0) + tan_a * tan_a, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> atan(const SparseJet<T, N> &f) {
+        return sparseChain(std::atan(f.a), T(1.0) / (T(1.0) + f.a * f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> sinh(const SparseJet<T, N> &f) {
+        return sparseChain(std::sinh(f.a), std::cosh(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> cosh(const SparseJet<T, N> &f) {
+        return sparseChain(std::cosh(f.a), std::sinh(f.a), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> tanh(const SparseJet<T, N> &f) {
+        const T tanh_a = std::tanh(f.a);
+        return sparseChain(tanh_a, T(1.0) - tanh_a * tanh_a, f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> floor(const SparseJet<T, N> &f) {
+        return SparseJet<T, N>(std::floor(f.a));
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> ceil(const SparseJet<T, N> &f) {
+        return SparseJet<T, N>(std::ceil(f.a));
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> cbrt(const SparseJet<T, N> &f) {
+        return sparseChain(std::cbrt(f.a), T(1.0) / (T(3.0) * std::cbrt(f.a * f.a)), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> exp2(const SparseJet<T, N> &f) {
+        const T tmp = std::exp2(f.a);
+        return sparseChain(tmp, tmp * std::log(T(2)), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> log2(const SparseJet<T, N> &f) {
+        return sparseChain(std::log2(f.a), T(1.0) / (f.a * std::log(T(2))), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> hypot(const SparseJet<T, N> &x, const SparseJet<T, N> &y) {
+        const T tmp = std::hypot(x.a, y.a);
+        return sparseChain(tmp, x.a / tmp, x, y.a / tmp, y);
+    }
+
+    template<typename T, int N>
+    inline const SparseJet<T, N> &fmax(const SparseJet<T, N> &x, const SparseJet<T, N> &y) {
+        return x < y ? y : x;
+    }
+
+    template<typename T, int N>
+    inline const SparseJet<T, N> &fmin(const SparseJet<T, N> &x, const SparseJet<T, N> &y) {
+        return y < x ? y : x;
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> atan2(const SparseJet<T, N> &g, const SparseJet<T, N> &f) {
+        T const tmp = T(1.0) / (f.a * f.a + g.a * g.a);
+        return sparseChain(std::atan2(g.a, f.a), -g.a * tmp, f, f.a * tmp, g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> pow(const SparseJet<T, N> &f, double g) {
+        return sparseChain(std::pow(f.a, g), T(g * std::pow(f.a, g - T(1.0))), f);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> pow(double f, const SparseJet<T, N> &g) {
+        if (f == 0 && g.a > 0)
+            return SparseJet<T, N>(T(0.0));
+        T const tmp = std::pow(f, g.a);
+        return sparseChain(tmp, T(std::log(f) * tmp), g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> pow(const SparseJet<T, N> &f, const SparseJet<T, N> &g) {
+        if (f.a == 0 && g.a >= 1) {
+            if (g.a > 1)
+                return SparseJet<T, N>(T(0.0));
+            return f;
+        }
+        T const tmp1 = std::pow(f.a, g.a);
+        T const tmp2 = g.a * std::pow(f.a, g.a - T(1.0));
+        T const tmp3 = tmp1 * std::log(f.a);
+        return sparseChain(tmp1, tmp2, f, tmp3, g);
+    }
+
+    template<typename T, int N>
+    inline SparseJet<T, N> fmod(const SparseJet<T, N> numer, T denom) {
+        return SparseJet<T, N>(std::fmod(numer.a, denom), numer.v);
+    }
+
+    template<typename T, int N>
+    inline bool isfinite(const SparseJet<T, N> &f) {
+        bool finite = std::isfinite(f.a);
+        f.v.forEach([&](int, const T &value) { finite = finite && std::isfinite(value); });
+        return finite;
+    }
+
+    template<typename T, int N>
+    inline bool isinf(const SparseJet<T, N> &f) {
+        bool inf = std::isinf(f.a);
+        f.v.forEach([&](int, const T &value) { inf = inf || std::isinf(value); });
+        return inf;
+    }
+
+    template<typename T, int N>
+    inline bool isnan(const SparseJet<T, N> &f) {
+        bool nan = std::isnan(f.a);
+        f.v.forEach([&](int, const T &value) { nan = nan || std::isnan(value); });
+        return nan;
+    }
+
+    template<typename T, int N>
+    inline std::ostream &operator<<(std::ostream &s, const SparseJet<T, N> &z) {
+        s << "[" << z.a << " ; ";
+        z.v.forEach([&](int index, const T &value) { s << index << ":" << value << " "; });
+        return s << "]";
+    }
+
+}  // namespace ceres
+
+namespace Eigen {
+
+    template<typename T, int N>
+    struct NumTraits<ceres::SparseJet<T, N>> {
+        typedef ceres::SparseJet<T, N> Real;
+        typedef ceres::SparseJet<T, N> NonInteger;
+        typedef ceres::SparseJet<T, N> Nested;
+        typedef ceres::SparseJet<T, N> Literal;
+
+        static typename ceres::SparseJet<T, N> dummy_precision() {
+            return ceres::SparseJet<T, N>(1e-12);
+        }
+
+        static inline Real epsilon() {
+            return Real(std::numeric_limits<T>::epsilon());
+        }
+
+        static inline int digits10() { return NumTraits<T>::digits10(); }
+
+        enum {
+            IsComplex = 0,
+            IsInteger = 0,
+            IsSigned,
+            ReadCost = 1,
+            AddCost = 1,
+            MulCost = 3,
+            HasFloatingPoint = 1,
+            RequireInitialization = 1
+        };
+
+        template<bool Vectorized>
+        struct Div {
+            enum {
+                AVX = false,
+                Cost = 3
+            };
+        };
+
+        static inline Real highest() { return Real(std::numeric_limits<T>::max()); }
+
+        static inline Real lowest() { return Real(-std::numeric_limits<T>::max()); }
+    };
+
+    template<typename BinaryOp, typename T, int N>
+    struct ScalarBinaryOpTraits<ceres::SparseJet<T, N>, T, BinaryOp> {
+        typedef ceres::SparseJet<T, N> ReturnType;
+    };
+    template<typename BinaryOp, typename T, int N>
+    struct ScalarBinaryOpTraits<T, ceres::SparseJet<T, N>, BinaryOp> {
+        typedef ceres::SparseJet<T, N> ReturnType;
+    };
+
+}  // namespace Eigen
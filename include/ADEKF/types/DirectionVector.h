@@ -75,17 +75,18 @@ namespace adekf {
          * This is required to calculate the limit of the derivative of the euclidean norm at norm=0.
          * The limit is calculated using the path where both values simultaneously approach 0.
          *
+         * @tparam Dual the type of the Jet (ceres::Jet or ceres::SparseJet)
          * @tparam OtherScalar the scalar type of the Jet
          * @tparam N the DOF of the Jet
          * @param a first value
          * @param b second value
          * @return r.a=sqrt(a.a^2+b.a^2), r.v = limit(a->0,b->0)  (a.a*a.v+b.a*b.v)/sqrt(a.a^2+b.a^2)
          */
-        template<typename OtherScalar, int N>
+        template<template<typename, int> class Dual, typename OtherScalar, int N>
         inline
-        static ceres::Jet<OtherScalar, N>
-        norm(const ceres::Jet<OtherScalar, N> &a, const ceres::Jet<OtherScalar, N> &b) {
-            ceres::Jet<OtherScalar, N> out;
+        static Dual<OtherScalar, N>
+        norm(const Dual<OtherScalar, N> &a, const Dual<OtherScalar, N> &b) {
+            Dual<OtherScalar, N> out;
 
             OtherScalar const temp1 = sqrt(pow(a.a, 2) + pow(b.a, 2));
             OtherScalar const multiplier = 1. / (temp1);
@@ -99,6 +100,29 @@ namespace adekf {
             return out;
         }
 
+        /**
+         * Calculates the euclidean norm of 2 ReverseJet values.
+         *
+         * Records the same limit of the derivative at norm=0 as the Jet overload.
+         *
+         * @tparam OtherScalar the scalar type of the ReverseJet
+         * @tparam N the number of inputs of the ReverseJet
+         * @param a first value
+         * @param b second value
+         * @return sqrt(a^2+b^2) with the limit derivative
+         */
+        template<typename OtherScalar, int N>
+        inline
+        static ceres::ReverseJet<OtherScalar, N>
+        norm(const ceres::ReverseJet<OtherScalar, N> &a, const ceres::ReverseJet<OtherScalar, N> &b) {
+            OtherScalar const temp1 = sqrt(pow(a.a, 2) + pow(b.a, 2));
+            OtherScalar const multiplier = 1. / (temp1);
+            //Check limit condition the limit is 1/sqrt(2)
+            OtherScalar const temp2 = temp1 == OtherScalar(0.) ? OtherScalar(1. / sqrt(2.)) : multiplier * (a.a);
+            OtherScalar const temp3 = temp1 == OtherScalar(0.) ? OtherScalar(1. / sqrt(2.)) : multiplier * (b.a);
+            return ceres::reverseChain(temp1, temp2, a, temp3, b);
+        }
+
         /**
          *   Calculates the Matrix that turns [1 0 0] to vector.
          *
@@ -206,6 +230,32 @@ namespace adekf {
     template<typename Derived>
     DirectionVector(const Eigen::MatrixBase<Derived> &) ->DirectionVector<typename Derived::Scalar>;
 
+    /**
+     * Reads the real parts of a direction vector of dual numbers. The vector is not normalized again
+     * @param direction The direction vector
+     * @return The direction vector of the real parts
+     */
+    template<typename T>
+    DirectionVector<ValueOf<T>> valueOf(const DirectionVector<T> &direction) {
+        DirectionVector<ValueOf<T>> value;
+        static_cast<Eigen::Matrix<ValueOf<T>, 3, 1> &>(value) = valueOf(
+                static_cast<const Eigen::Matrix<T, 3, 1> &>(direction));
+        return value;
+    }
+
+    /**
+     * Converts a direction vector to another scalar type. The vector is not normalized again
+     * @tparam NewScalar The scalar type to convert to
+     * @param direction The direction vector
+     * @return The direction vector with the new scalar type
+     */
+    template<typename NewScalar, typename T>
+    DirectionVector<NewScalar> castTo(const DirectionVector<T> &direction) {
+        DirectionVector<NewScalar> converted;
+        static_cast<Eigen::Matrix<NewScalar, 3, 1> &>(converted) = direction.template cast<NewScalar>();
+        return converted;
+    }
+
     using DVf = DirectionVector<float>;
     using DVd = DirectionVector<double>;
 }
@@ -150,6 +150,27 @@ public:
 template<typename Derived>
 SO3(const Eigen::MatrixBase<Derived> & ) -> SO3<typename Derived::Scalar>;
 
+/**
+ * Reads the real parts of a rotation of dual numbers. The quaternion is not normalized again
+ * @param rotation The rotation
+ * @return The rotation of the real parts
+ */
+template<typename T>
+SO3<ValueOf<T>> valueOf(const SO3<T> &rotation) {
+    return SO3<ValueOf<T>>(Eigen::Quaternion<ValueOf<T>>(valueOf(rotation.coeffs())));
+}
+
+/**
+ * Converts a rotation to another scalar type. The quaternion is not normalized again
+ * @tparam NewScalar The scalar type to convert to
+ * @param rotation The rotation
+ * @return The rotation with the new scalar type
+ */
+template<typename NewScalar, typename T>
+SO3<NewScalar> castTo(const SO3<T> &rotation) {
+    return SO3<NewScalar>(Eigen::Quaternion<NewScalar>(rotation.coeffs().template cast<NewScalar>()));
+}
+
 using SO3f = SO3<float>;
 using SO3d = SO3<double>;
 }
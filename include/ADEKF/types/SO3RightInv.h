@@ -124,6 +124,27 @@ public:
 template<typename Derived>
 SO3RightInvariant(const Eigen::MatrixBase<Derived> & ) -> SO3<typename Derived::Scalar>;
 
+/**
+ * Reads the real parts of a rotation of dual numbers. The quaternion is not normalized again
+ * @param rotation The rotation
+ * @return The rotation of the real parts
+ */
+template<typename T>
+SO3RightInvariant<ValueOf<T>> valueOf(const SO3RightInvariant<T> &rotation) {
+    return SO3RightInvariant<ValueOf<T>>(Eigen::Quaternion<ValueOf<T>>(valueOf(rotation.coeffs())));
+}
+
+/**
+ * Converts a rotation to another scalar type. The quaternion is not normalized again
+ * @tparam NewScalar The scalar type to convert to
+ * @param rotation The rotation
+ * @return The rotation with the new scalar type
+ */
+template<typename NewScalar, typename T>
+SO3RightInvariant<NewScalar> castTo(const SO3RightInvariant<T> &rotation) {
+    return SO3RightInvariant<NewScalar>(Eigen::Quaternion<NewScalar>(rotation.coeffs().template cast<NewScalar>()));
+}
+
 using SO3RightInvariantf = SO3RightInvariant<float>;
 using SO3RightInvariantd = SO3RightInvariant<double>;
 }
@@ -0,0 +1,22 @@
+#ifndef ADEKF_ALLOCATIONCOUNTER_H
+#define ADEKF_ALLOCATIONCOUNTER_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Number of heap allocations of the program. Counted by replacing malloc which is used by Eigen and operator new.
+ * Only available with glibc, stays 0 otherwise.
+ *
+ * Replaces malloc for the whole program, so include this header in exactly one translation unit.
+ */
+static std::atomic<std::size_t> allocationCounter{0};
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size) {
+    ++allocationCounter;
+    return __libc_malloc(size);
+}
+#endif
+
+#endif //ADEKF_ALLOCATIONCOUNTER_H
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include "DelayedADEKF.h"
+#include "TestModels.h"
+
+/**
+ * A measurement with its time stamp
+ */
+struct TimedMeasurement {
+    double time;
+    Eigen::Vector3d z;
+};
+
+/**
+ * Tests that measurements which arrive late give the same result as measurements in order
+ *
+ * The measurements are nonlinear in the manifold state, so the repeated steps are linearized again.
+ */
+TEST (DelayedTests, LateMeasurementsEqualMeasurementsInOrder) {
+    Pose<double> initial = startPose();
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    Eigen::Matrix3d R = Eigen::Matrix3d::Identity() * 0.1;
+    double const dt = 0.1;
+    //Measurements every second step, each arrives 3 steps late
+    std::vector<TimedMeasurement> measurements;
+    for (int i = 0; i < 20; i += 2)
+        measurements.push_back({i * dt, Eigen::Vector3d(1. + 0.1 * i, 0.2, 0.3)});
+
+    adekf::ADEKF inOrder(initial, Eigen::MatrixXd::Identity(15, 15));
+    adekf::DelayedADEKF delayed(initial, Eigen::MatrixXd::Identity(15, 15), 1., 20);
+    for (int i = 1; i <= 25; ++i) {
+        inOrder.predict(dynamicModel, Q, dt);
+        if (i % 2 == 0 && i < 20)
+            inOrder.update(positionModel, R, measurements[i / 2].z);
+        ASSERT_TRUE(delayed.predict(i * dt, dynamicModel, Q, dt));
+        if (i % 2 == 1 && i >= 3 && i < 21) {
+            const TimedMeasurement &late = measurements[(i - 3) / 2 + 1];
+            ASSERT_TRUE(delayed.update(late.time, positionModel, R, late.z));
+        }
+    }
+    EXPECT_NEAR((delayed.mu - inOrder.mu).norm(), 0., 1e-12);
+    EXPECT_NEAR((delayed.sigma - inOrder.sigma).norm(), 0., 1e-12);
+}
+
+/**
+ * Tests that the history is bounded by its window and older measurements are dropped
+ */
+TEST (DelayedTests, HistoryIsBoundedByWindow) {
+    adekf::DelayedADEKF delayed(startPose(), Eigen::MatrixXd::Identity(15, 15), 0.5, 100);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    for (int i = 1; i <= 20; ++i)
+        delayed.predict(i * 0.1, dynamicModel, Q, 0.1);
+    EXPECT_LE(delayed.historySize(), 6u);
+    Eigen::MatrixXd sigma = delayed.sigma;
+    EXPECT_FALSE(delayed.update(1.0, positionModel, Eigen::Matrix3d::Identity(), Eigen::Vector3d(1, 0, 0)));
+    EXPECT_EQ(delayed.sigma, sigma);
+    EXPECT_TRUE(delayed.update(1.7, positionModel, Eigen::Matrix3d::Identity(), Eigen::Vector3d(1, 0, 0)));
+}
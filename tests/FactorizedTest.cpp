@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include "TestModels.h"
+
+/**
+ * Runs the same steps on a factorized filter and on an ADEKF
+ * @param filter The factorized filter
+ * @param reference The ADEKF
+ * @param steps The number of steps
+ */
+template<typename Filter>
+void runBoth(Filter &filter, adekf::ADEKF<Pose<double>> &reference, int steps) {
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    Eigen::Matrix3d R3 = Eigen::Matrix3d::Identity() * 0.1;
+    Eigen::Matrix<double, 1, 1> R1 = Eigen::Matrix<double, 1, 1>::Identity() * 0.1;
+    for (int i = 0; i < steps; ++i) {
+        Eigen::Vector3d z(1. + 0.1 * i, 2., 3.);
+        filter.predict(dynamicModel, Q, 0.1);
+        reference.predict(dynamicModel, Q, 0.1);
+        filter.update(positionModel, R3, z);
+        reference.update(positionModel, R3, z);
+        filter.update(speedModel, R1, 1.);
+        reference.update(speedModel, R1, 1.);
+    }
+}
+
+/**
+ * A precise scalar measurement of two strongly correlated states in single precision
+ *
+ * The downdate of the Cholesky factor subtracts nearly the whole variance of both states, so rounding errors make it
+ * indefinite.
+ * @tparam Filter The filter type
+ * @param filter The filter, started with precisePrior()
+ * @param steps The number of steps
+ */
+template<typename Filter>
+void runPrecise(Filter &filter, int steps) {
+    using Scalar = typename adekf::StateInfo<std::decay_t<decltype(filter.mu)>>::ScalarType;
+    using Matrix = Eigen::Matrix<Scalar, 3, 3>;
+    Matrix Q = Matrix::Identity() * Scalar(1e-4);
+    Eigen::Matrix<Scalar, 1, 1> R = Eigen::Matrix<Scalar, 1, 1>::Identity() * Scalar(1e-6);
+    for (int i = 0; i < steps; ++i) {
+        filter.predict([](auto &state) { state(2) += state(0) * Scalar(0.1); }, Q);
+        filter.update([](auto &state) { return state(0) + state(1) * Scalar(0.5); }, R, Scalar(1));
+        filter.update([](auto &state) { return state(0); }, R, Scalar(1));
+    }
+}
+
+/**
+ * @return A prior with two strongly correlated states
+ */
+template<typename Scalar>
+Eigen::Matrix<Scalar, 3, 3> precisePrior() {
+    Eigen::Matrix<Scalar, 3, 3> prior;
+    prior << 1e4, 9.999e3, 0, 9.999e3, 1e4, 0, 0, 0, 1;
+    return prior;
+}
+
+/**
+ * Tests that L*L^T of the SqrtADEKF equals the covariance of the ADEKF on a manifold state
+ */
+TEST (FactorizedTests, SqrtEqualsADEKF) {
+    adekf::SqrtADEKF filter(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    adekf::ADEKF reference(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    runBoth(filter, reference, 10);
+    EXPECT_NEAR((filter.mu - reference.mu).norm(), 0., 1e-10);
+    EXPECT_TRUE(filter.covariance().isApprox(reference.sigma, 1e-10));
+    //The factor stays lower triangular
+    EXPECT_TRUE(filter.sqrtSigma.isLowerTriangular());
+}
+
+/**
+ * Tests that a downdate which would go indefinite by rounding returns false
+ */
+TEST (FactorizedTests, IndefiniteDowndateIsDetected) {
+    Eigen::Matrix2d L = Eigen::Matrix2d::Identity();
+    EXPECT_FALSE(adekf::choleskyDowndate(L, Eigen::Vector2d(1., 0.)));
+    L.setIdentity();
+    EXPECT_TRUE(adekf::choleskyDowndate(L, Eigen::Vector2d(0.5, 0.5)));
+    EXPECT_TRUE((L * L.transpose()).isApprox(Eigen::Matrix2d(Eigen::Matrix2d::Identity() -
+                                                                Eigen::Vector2d(0.5, 0.5) *
+                                                                Eigen::Vector2d(0.5, 0.5).transpose())));
+}
+
+/**
+ * Tests that the SqrtADEKF in single precision stays positive definite and close to double precision with precise
+ * measurements, whose downdates go indefinite by rounding
+ */
+TEST (FactorizedTests, SqrtSinglePrecisionWithPreciseMeasurements) {
+    adekf::SqrtADEKF filter(Eigen::Vector3f::Zero().eval(), precisePrior<float>());
+    adekf::ADEKF reference(Eigen::Vector3d::Zero().eval(), precisePrior<double>());
+    runPrecise(filter, 20);
+    runPrecise(reference, 20);
+    Eigen::Matrix3d covariance = filter.covariance().cast<double>();
+    EXPECT_EQ(Eigen::LLT<Eigen::Matrix3d>(covariance).info(), Eigen::Success);
+    EXPECT_TRUE((filter.sqrtSigma.diagonal().array() > 0).all());
+    EXPECT_NEAR((filter.mu.cast<double>() - reference.mu).norm(), 0., 1e-3);
+    EXPECT_TRUE(covariance.isApprox(reference.sigma, 1e-3));
+}
+
+/**
+ * Tests that U*diag(d)*U^T of the UDADEKF equals the covariance of the ADEKF with diagonal and scalar measurement noise
+ */
+TEST (FactorizedTests, UDEqualsADEKF) {
+    adekf::UDADEKF filter(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    adekf::ADEKF reference(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    runBoth(filter, reference, 10);
+    EXPECT_NEAR((filter.mu - reference.mu).norm(), 0., 1e-10);
+    EXPECT_TRUE(filter.covariance().isApprox(reference.sigma, 1e-10));
+    //U stays unit upper triangular and d positive
+    EXPECT_TRUE(filter.U.isUpperTriangular());
+    EXPECT_TRUE((filter.U.diagonal().array() == 1.).all());
+    EXPECT_TRUE((filter.d.array() > 0).all());
+}
+
+/**
+ * Tests that correlated measurement noise is decorrelated by the UDADEKF instead of using only its diagonal
+ */
+TEST (FactorizedTests, UDDecorrelatesMeasurementNoise) {
+    adekf::UDADEKF filter(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    adekf::ADEKF reference(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    runBoth(filter, reference, 3);
+    Eigen::Matrix3d R;
+    R << 0.2, 0.05, -0.03, 0.05, 0.1, 0.02, -0.03, 0.02, 0.15;
+    Eigen::Vector3d z(1.5, 2., 3.);
+    filter.update(positionModel, R, z);
+    reference.update(positionModel, R, z);
+    EXPECT_NEAR((filter.mu - reference.mu).norm(), 0., 1e-10);
+    EXPECT_TRUE(filter.covariance().isApprox(reference.sigma, 1e-10));
+    //Only the diagonal of R gives a different result
+    adekf::UDADEKF diagonal(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    adekf::ADEKF unused(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    runBoth(diagonal, unused, 3);
+    diagonal.update(positionModel, Eigen::Matrix3d(R.diagonal().asDiagonal()), z);
+    EXPECT_FALSE(diagonal.covariance().isApprox(reference.sigma, 1e-6));
+}
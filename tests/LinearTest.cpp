@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "TestModels.h"
+
+/**
+ * Tests that predictLinear probes a linear model again when its controls change
+ *
+ * The Jacobian of a constant velocity model depends on the time difference, a cached Jacobian of the first time
+ * difference would give a wrong covariance.
+ */
+TEST (LinearTests, ChangingControlsAreProbedAgain) {
+    using Vector = Eigen::Matrix<double, 4, 1>;
+    using Matrix = Eigen::Matrix<double, 4, 4>;
+    auto constantVelocity = [](auto &state, double dt) {
+        state.template head<2>() += dt * state.template tail<2>();
+    };
+    Matrix Q = Matrix::Identity() * 0.01;
+    Vector start(1., 2., 0.5, -0.5);
+    adekf::ADEKF linear(start, Matrix::Identity().eval());
+    adekf::ADEKF reference(start, Matrix::Identity().eval());
+    for (double dt: {0.1, 0.1, 0.5, 0.2, 0.2}) {
+        linear.predictLinear(constantVelocity, Q, dt);
+        reference.predict(constantVelocity, Q, dt);
+        EXPECT_NEAR((linear.mu - reference.mu).norm(), 0., 1e-12);
+        EXPECT_NEAR((linear.sigma - reference.sigma).norm(), 0., 1e-12);
+    }
+}
+
+/**
+ * Tests that updateLinear probes a linear model again when its auxiliary variables change
+ */
+TEST (LinearTests, ChangingVariablesAreProbedAgain) {
+    using Vector = Eigen::Matrix<double, 4, 1>;
+    using Matrix = Eigen::Matrix<double, 4, 4>;
+    auto scaledPosition = [](auto &state, const Eigen::Vector2d &scale) {
+        return (state.template head<2>().cwiseProduct(scale)).eval();
+    };
+    Eigen::Matrix2d R = Eigen::Matrix2d::Identity() * 0.1;
+    Vector start(1., 2., 0.5, -0.5);
+    adekf::ADEKF linear(start, Matrix::Identity().eval());
+    adekf::ADEKF reference(start, Matrix::Identity().eval());
+    for (double scale: {1., 1., 2., 0.5}) {
+        Eigen::Vector2d scales(scale, 1.);
+        linear.updateLinear(scaledPosition, R, Eigen::Vector2d(1., 2.), scales);
+        reference.update(scaledPosition, R, Eigen::Vector2d(1., 2.), scales);
+        EXPECT_NEAR((linear.mu - reference.mu).norm(), 0., 1e-12);
+        EXPECT_NEAR((linear.sigma - reference.sigma).norm(), 0., 1e-12);
+    }
+}
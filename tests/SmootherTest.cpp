@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include "TestModels.h"
+
+#include <random>
+#include <vector>
+
+/**
+ * Tests that the lag L estimate of a linear model equals the full Rauch-Tung-Striebel pass at the same step
+ */
+TEST (SmootherTests, LinearModelEqualsFullPass) {
+    using Vector = Eigen::Matrix<double, 4, 1>;
+    using Matrix = Eigen::Matrix<double, 4, 4>;
+    int const steps = 30, lag = 5;
+    Matrix F;
+    F << 1, 0.1, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0.1, 0, 0, 0, 0.95;
+    Matrix Q = Matrix::Identity() * 0.01;
+    Eigen::Matrix2d R = Eigen::Matrix2d::Identity() * 0.1;
+    std::mt19937 generator(1);
+    std::normal_distribution<double> noise;
+    adekf::ADEKF ekf(Vector::Zero().eval(), Matrix::Identity().eval());
+    ekf.smoother.emplace(lag);
+    //The estimates of the forward pass
+    std::vector<Vector> filteredMu, predictedMu;
+    std::vector<Matrix> filteredSigma, predictedSigma;
+    for (int i = 0; i < steps; ++i) {
+        filteredMu.push_back(ekf.mu);
+        filteredSigma.push_back(ekf.sigma);
+        ekf.predict([&F](auto &state) { state = (F * state).eval(); }, Q);
+        predictedMu.push_back(ekf.mu);
+        predictedSigma.push_back(ekf.sigma);
+        ekf.update([](auto &state) { return Eigen::Matrix<std::decay_t<decltype(state(0))>, 2, 1>(state(0), state(2)); },
+                   R, Eigen::Vector2d(noise(generator), noise(generator)));
+    }
+    //The full backward pass down to the first step
+    Vector smoothedMu = ekf.mu;
+    Matrix smoothedSigma = ekf.sigma;
+    for (int i = steps - 1; i >= steps - lag; --i) {
+        Matrix C = filteredSigma[i] * F.transpose() * predictedSigma[i].inverse();
+        smoothedMu = filteredMu[i] + C * (smoothedMu - predictedMu[i]);
+        smoothedSigma = filteredSigma[i] + C * (smoothedSigma - predictedSigma[i]) * C.transpose();
+    }
+    ASSERT_TRUE(ekf.smoother->smooth(ekf.mu, ekf.sigma));
+    EXPECT_NEAR((ekf.smoother->mu - smoothedMu).norm(), 0., 1e-12);
+    EXPECT_NEAR((ekf.smoother->sigma - smoothedSigma).norm(), 0., 1e-12);
+}
+
+/**
+ * Differentiates a function of the offset in the tangent space numerically with central differences
+ * @param g The function g(delta) which returns an offset in a tangent space
+ * @return The Jacobian of g at delta=0
+ */
+template<typename Function>
+Eigen::Matrix<double, 15, 15> numericJacobian(Function g) {
+    double const h = 1e-6;
+    Eigen::Matrix<double, 15, 15> jacobian;
+    for (int j = 0; j < 15; ++j) {
+        Eigen::Matrix<double, 15, 1> delta = Eigen::Matrix<double, 15, 1>::Unit(j) * h;
+        jacobian.col(j) = (g(delta) - g(-delta)) / (2 * h);
+    }
+    return jacobian;
+}
+
+/**
+ * Tests the lag L estimate of a state with an SO3 member against a naive backward pass in the tangent spaces
+ *
+ * The naive pass uses numeric Jacobians of the dynamic model and of the change of the reference, so the boxplus and
+ * boxminus paths of the smoother are checked independently of automatic differentiation.
+ */
+TEST (SmootherTests, ManifoldStateEqualsNaivePass) {
+    using Matrix = Eigen::Matrix<double, 15, 15>;
+    using Vector = Eigen::Matrix<double, 15, 1>;
+    int const steps = 12, lag = 6;
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    Eigen::Matrix3d R3 = Eigen::Matrix3d::Identity() * 0.1;
+    Eigen::Matrix<double, 1, 1> R1 = Eigen::Matrix<double, 1, 1>::Identity() * 0.1;
+    adekf::ADEKF ekf(startPose(), Eigen::MatrixXd::Identity(15, 15));
+    ekf.smoother.emplace(lag);
+    std::vector<Pose<double>> filteredMu, predictedMu;
+    std::vector<Matrix> filteredSigma, predictedSigma, F;
+    for (int i = 0; i < steps; ++i) {
+        filteredMu.push_back(ekf.mu);
+        filteredSigma.push_back(ekf.sigma);
+        Pose<double> reference = ekf.mu;
+        dynamicModel(reference, 0.1);
+        F.push_back(numericJacobian([&](const Vector &delta) {
+            Pose<double> moved = ekf.mu + delta;
+            dynamicModel(moved, 0.1);
+            return Vector(moved - reference);
+        }));
+        ekf.predict(dynamicModel, Q, 0.1);
+        predictedMu.push_back(ekf.mu);
+        predictedSigma.push_back(ekf.sigma);
+        ekf.update(positionModel, R3, Eigen::Vector3d(1. + 0.1 * i, 2., 3.));
+        ekf.update(speedModel, R1, 1.);
+    }
+    //Moves a covariance from ref1 to ref2 with the Jacobian of (ref1+(Er1+delta))-ref2
+    auto moveReference = [](const Pose<double> &ref1, const Pose<double> &ref2, const Vector &Er1, Matrix &P) {
+        Matrix D = numericJacobian([&](const Vector &delta) { return Vector((ref1 + (Er1 + delta).eval()) - ref2); });
+        P = D * P * D.transpose();
+    };
+    Pose<double> smoothedMu = ekf.mu;
+    Matrix smoothedSigma = ekf.sigma;
+    for (int i = steps - 1; i >= steps - lag; --i) {
+        moveReference(smoothedMu, predictedMu[i], predictedMu[i] - smoothedMu, smoothedSigma);
+        Matrix C = filteredSigma[i] * F[i].transpose() * predictedSigma[i].inverse();
+        Vector correction = C * (smoothedMu - predictedMu[i]);
+        smoothedSigma = filteredSigma[i] + C * (smoothedSigma - predictedSigma[i]) * C.transpose();
+        smoothedMu = filteredMu[i] + correction;
+        moveReference(filteredMu[i], smoothedMu, correction, smoothedSigma);
+    }
+    ASSERT_TRUE(ekf.smoother->smooth(ekf.mu, ekf.sigma));
+    EXPECT_NEAR((ekf.smoother->mu - smoothedMu).norm(), 0., 1e-8);
+    EXPECT_NEAR((ekf.smoother->sigma - smoothedSigma).norm(), 0., 1e-8);
+}
+
+/**
+ * Tests that the smoothed estimates of a state with an SO3 member are closer to the truth than the filtered ones
+ *
+ * Only the orientation and the position are compared, the velocity and the bias are barely observable.
+ */
+TEST (SmootherTests, ManifoldStateIsSmoothed) {
+    int const runs = 10, steps = 40, lag = 4;
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.0025;
+    Eigen::Matrix3d R = Eigen::Matrix3d::Identity() * 0.01;
+    auto directionModel = [](auto &state) {
+        return (state.orientation * Eigen::Vector3d(1, 0, 0)).eval();
+    };
+    std::mt19937 generator(2);
+    std::normal_distribution<double> noise;
+    auto sample = [&](int size, double deviation) {
+        return Eigen::VectorXd(Eigen::VectorXd::NullaryExpr(size, [&] { return deviation * noise(generator); }));
+    };
+    double filteredError = 0., smoothedError = 0., filteredTrace = 0., smoothedTrace = 0.;
+    for (int run = 0; run < runs; ++run) {
+        Pose<double> truth = startPose();
+        adekf::ADEKF ekf(truth, Eigen::MatrixXd::Identity(15, 15) * 0.1);
+        ekf.smoother.emplace(lag);
+        //The truth and the filtered estimate after each step
+        std::vector<Pose<double>> truths, filtered;
+        std::vector<double> traces;
+        for (int i = 0; i < steps; ++i) {
+            dynamicModel(truth, 0.1);
+            truth = truth + Eigen::Matrix<double, 15, 1>(sample(15, 0.05));
+            ekf.predict(dynamicModel, Q, 0.1);
+            ekf.update(directionModel, R, (directionModel(truth) + sample(3, 0.1)).eval());
+            ekf.update(positionModel, R, (positionModel(truth) + sample(3, 0.1)).eval());
+            truths.push_back(truth);
+            filtered.push_back(ekf.mu);
+            traces.push_back(ekf.sigma.topLeftCorner<6, 6>().trace());
+            //The smoothed estimate belongs to the step lag steps ago
+            if (ekf.smoother->smooth(ekf.mu, ekf.sigma) && i >= 10) {
+                int smoothedStep = i - lag;
+                filteredError += (filtered[smoothedStep] - truths[smoothedStep]).head<6>().squaredNorm();
+                smoothedError += (ekf.smoother->mu - truths[smoothedStep]).head<6>().squaredNorm();
+                filteredTrace += traces[smoothedStep];
+                smoothedTrace += ekf.smoother->sigma.topLeftCorner<6, 6>().trace();
+            }
+        }
+    }
+    EXPECT_LT(smoothedError, 0.9 * filteredError);
+    EXPECT_LT(smoothedTrace, filteredTrace);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ADEKF.h"
+#include "ManifoldCreator.h"
+#include "types/SO3.h"
+
+/**
+ * A state with 15 DOF, so the covariance, the Jacobians and the Jets are dynamic sized
+ */
+ADEKF_MANIFOLD(Pose, ((adekf::SO3, orientation)), (3, position), (3, velocity), (6, bias))
+
+/**
+ * @return The initial estimate of the test filters, moving away from the origin without bias
+ */
+inline Pose<double> startPose() {
+    Pose<double> start;
+    start.position = Eigen::Vector3d(1, 0, 0);
+    start.velocity = Eigen::Vector3d(0.5, 0.1, 0);
+    start.bias.setZero();
+    return start;
+}
+
+/**
+ * Rotates with a constant rate and integrates the velocity and the acceleration bias
+ */
+inline auto dynamicModel = [](auto &state, double dt) {
+    state.orientation = state.orientation + Eigen::Vector3d(0.01, 0.02, 0.03);
+    state.position += dt * state.velocity;
+    state.velocity += dt * state.bias.template head<3>();
+};
+
+/**
+ * Measures the rotated position, a vector measurement
+ */
+inline auto positionModel = [](auto &state) {
+    return (state.orientation * state.position).eval();
+};
+
+/**
+ * Measures the speed, a scalar measurement
+ */
+inline auto speedModel = [](auto &state) {
+    return state.velocity.norm();
+};
@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include "TestModels.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * The result of one filter run
+ */
+struct RunResult {
+    Eigen::Matrix<double, 15, 1> offset;
+    Eigen::MatrixXd sigma;
+};
+
+/**
+ * Runs a filter with all differentiation modes
+ * @param seed Varies the measurements, so every thread computes something different
+ * @param steps The number of steps
+ * @param start Waited for before the first step, lets all threads start at once
+ * @return The difference of the final state to the start and the final covariance
+ */
+RunResult runFilter(int seed, int steps, const std::atomic<bool> &start) {
+    Pose<double> initial = startPose();
+    adekf::ADEKF ekf(initial, Eigen::MatrixXd::Identity(15, 15), seed % 2 == 0);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    Eigen::Matrix3d R3 = Eigen::Matrix3d::Identity() * 0.1;
+    Eigen::Matrix<double, 1, 1> R1 = Eigen::Matrix<double, 1, 1>::Identity() * 0.1;
+    while (!start);
+    for (int i = 0; i < steps; ++i) {
+        Eigen::Vector3d z(1. + seed, 2., 3. - 0.1 * i);
+        if (i % 2 == 0)
+            ekf.predict(dynamicModel, Q, 0.1);
+        else
+            ekf.predictSparse(dynamicModel, Q, 0.1);
+        //Forward mode update
+        ekf.updateChunked(positionModel, R3, z);
+        ekf.updateSparse(positionModel, R3, z);
+        ekf.update(positionModel, R3, z);
+        //Reverse mode update
+        ekf.update(speedModel, R1, 1.);
+    }
+    return RunResult{ekf.mu - initial, ekf.sigma};
+}
+
+/**
+ * Tests that filters in parallel threads compute the same results as sequential runs
+ *
+ * The threads run first, so the shared dual component vectors of the state are created while they run.
+ * Build with -fsanitize=thread to check for data races.
+ */
+TEST (ThreadTests, IndependentFiltersInParallel) {
+    int const threadCount = 8, steps = 30;
+    std::atomic<bool> start{false};
+    std::vector<RunResult> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+        threads.emplace_back([&, t] { results[t] = runFilter(t, steps, start); });
+    start = true;
+    for (auto &thread : threads)
+        thread.join();
+    std::atomic<bool> started{true};
+    for (int t = 0; t < threadCount; ++t) {
+        RunResult reference = runFilter(t, steps, started);
+        ASSERT_EQ(results[t].offset, reference.offset);
+        ASSERT_EQ(results[t].sigma, reference.sigma);
+    }
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "misc/AllocationCounter.h"
+#include "DelayedADEKF.h"
+#include "TestModels.h"
+
+/**
+ * Runs a few steps with predict and updates of two measurement sizes
+ * @param ekf The filter
+ * @param Q The process noise, allocated by the caller
+ * @param steps The number of steps
+ */
+template<typename Filter>
+void runFilter(Filter &ekf, const Eigen::MatrixXd &Q, int steps) {
+    Eigen::Matrix3d R3 = Eigen::Matrix3d::Identity() * 0.1;
+    Eigen::Matrix<double, 1, 1> R1 = Eigen::Matrix<double, 1, 1>::Identity() * 0.1;
+    for (int i = 0; i < steps; ++i) {
+        ekf.predict(dynamicModel, Q, 0.1);
+        //Forward mode update with a vector measurement
+        ekf.update(positionModel, R3, Eigen::Vector3d(1., 2., 3.));
+        //Reverse mode update with a scalar measurement
+        ekf.update(speedModel, R1, 1.);
+    }
+}
+
+/**
+ * Tests that a filter with a kept workspace does not allocate after a warm up
+ */
+TEST (WorkspaceTests, ZeroAllocationsAfterWarmUp) {
+#ifndef __GLIBC__
+    GTEST_SKIP() << "Allocations can only be counted with glibc";
+#endif
+    Pose<double> start = startPose();
+    adekf::ADEKF ekf(start, Eigen::MatrixXd::Identity(15, 15), true);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    runFilter(ekf, Q, 2);
+    std::size_t allocationsBefore = allocationCounter;
+    runFilter(ekf, Q, 10);
+    ASSERT_EQ(allocationCounter - allocationsBefore, 0u);
+}
+
+/**
+ * Tests that the workspace does not change the result
+ */
+TEST (WorkspaceTests, SameResultAsWithoutWorkspace) {
+    Pose<double> start = startPose();
+    adekf::ADEKF ekf(start, Eigen::MatrixXd::Identity(15, 15), true);
+    adekf::ADEKF reference(start, Eigen::MatrixXd::Identity(15, 15));
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    runFilter(ekf, Q, 5);
+    runFilter(reference, Q, 5);
+    ASSERT_TRUE((ekf.mu - reference.mu).isZero(1e-12));
+    ASSERT_TRUE(ekf.sigma.isApprox(reference.sigma, 1e-12));
+}
+
+/**
+ * Tests that a fixed lag smoother does not allocate after it was created and its buffer was filled once
+ */
+TEST (WorkspaceTests, SmootherDoesNotAllocate) {
+#ifndef __GLIBC__
+    GTEST_SKIP() << "Allocations can only be counted with glibc";
+#endif
+    Pose<double> start = startPose();
+    adekf::ADEKF ekf(start, Eigen::MatrixXd::Identity(15, 15), true);
+    ekf.smoother.emplace(3);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    runFilter(ekf, Q, 3);
+    ASSERT_TRUE(ekf.smoother->smooth(ekf.mu, ekf.sigma));
+    std::size_t allocationsBefore = allocationCounter;
+    for (int i = 0; i < 10; ++i) {
+        runFilter(ekf, Q, 1);
+        ekf.smoother->smooth(ekf.mu, ekf.sigma);
+    }
+    ASSERT_EQ(allocationCounter - allocationsBefore, 0u);
+}
+
+/**
+ * Tests that Jets on the heap copy the derivatives of Jets in the arena instead of taking their storage
+ */
+TEST (WorkspaceTests, HeapJetsOutliveArenaScopes) {
+    using Jet = ceres::Jet<double, 15>;
+    using SparseJet = ceres::SparseJet<double, 15>;
+    Jet kept(0., 0);
+    SparseJet keptSparse(0., 0);
+    ceres::JetArena arena;
+    {
+        ceres::JetArena::Scope scope(arena);
+        kept = Jet(2., 3);
+        keptSparse = SparseJet(2., 3);
+    }
+    {
+        //Reuses the memory of the first scope
+        ceres::JetArena::Scope scope(arena);
+        Jet overwrite(5., 7);
+        SparseJet overwriteSparse(5., 7);
+        ASSERT_EQ(overwrite.v[7] + overwriteSparse.v[7], 2.);
+    }
+    ASSERT_EQ(kept.a, 2.);
+    ASSERT_EQ(kept.v[3], 1.);
+    ASSERT_EQ(kept.v[7], 0.);
+    ASSERT_EQ(keptSparse.v[3], 1.);
+    ASSERT_EQ(keptSparse.v[7], 0.);
+}
+
+/**
+ * Tests that the DelayedADEKF reuses its history, also for late measurements which repeat later steps
+ *
+ * The capacity is smaller than the number of steps, so the history wraps around.
+ */
+TEST (WorkspaceTests, DelayedDoesNotAllocate) {
+#ifndef __GLIBC__
+    GTEST_SKIP() << "Allocations can only be counted with glibc";
+#endif
+    adekf::DelayedADEKF delayed(startPose(), Eigen::MatrixXd::Identity(15, 15), 10., 8);
+    delayed.workspace.setEnabled(true);
+    Eigen::MatrixXd Q = Eigen::MatrixXd::Identity(15, 15) * 0.01;
+    Eigen::Matrix3d R = Eigen::Matrix3d::Identity() * 0.1;
+    auto step = [&](int i) {
+        delayed.predict(i * 0.1, dynamicModel, Q, 0.1);
+        if (i % 2 == 1) {
+            ASSERT_TRUE(delayed.update((i - 1) * 0.1, positionModel, R, Eigen::Vector3d(1., 2., 3.)));
+        }
+    };
+    //Fill the history, so the pool of process noises has its final size
+    for (int i = 1; i <= 8; ++i)
+        step(i);
+    std::size_t allocationsBefore = allocationCounter;
+    for (int i = 9; i <= 24; ++i)
+        step(i);
+    ASSERT_EQ(allocationCounter - allocationsBefore, 0u);
+    EXPECT_EQ(delayed.historySize(), 8u);
+}